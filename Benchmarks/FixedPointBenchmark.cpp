@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    Throughput and SNR of the fixed-point MonoChain against the float path.
+
+    Every run of the chain is measured against a double precision reference
+    built from the same designs. The float path does what juce::dsp::IIR::Filter
+    does, so its SNR is the bar the fixed-point versions are held to. The
+    fixed-point outputs are pure integer maths, so their checksums have to be
+    identical on every platform the chain is deployed to. Tests/NVSEQTests.cpp
+    holds the expected values and fails if they ever change.
+
+  ==============================================================================
+*/
+
+#include "FixedPointChain.h"
+#include "FixedPointScenarios.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    using namespace FixedPointScenarios;
+
+    constexpr int numTimingRuns = 5;
+
+    // transposed direct form II, the same structure as juce::dsp::IIR::Filter
+    template <typename SampleType>
+    class FloatingPointChain
+    {
+    public:
+        explicit FloatingPointChain(const ChainCoefficients& coefficients)
+        {
+            for (int i = 0; i < coefficients.lowCut.numSections; ++i)
+                addSection(coefficients.lowCut.sections[(size_t) i]);
+
+            addSection(coefficients.peak);
+
+            for (int i = 0; i < coefficients.highCut.numSections; ++i)
+                addSection(coefficients.highCut.sections[(size_t) i]);
+        }
+
+        void reset()
+        {
+            for (auto& section : sections)
+                section.state1 = section.state2 = 0;
+        }
+
+        void process(SampleType* samples, int count)
+        {
+            for (auto& section : sections)
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    auto input = samples[i];
+                    auto output = section.b0 * input + section.state1;
+                    section.state1 = section.b1 * input - section.a1 * output + section.state2;
+                    section.state2 = section.b2 * input - section.a2 * output;
+                    samples[i] = output;
+                }
+            }
+        }
+
+    private:
+        struct Section
+        {
+            SampleType b0, b1, b2, a1, a2;
+            SampleType state1{0}, state2{0};
+        };
+
+        void addSection(const BiquadSection& section)
+        {
+            sections.push_back({ (SampleType) section.b0, (SampleType) section.b1, (SampleType) section.b2,
+                                 (SampleType) section.a1, (SampleType) section.a2 });
+        }
+
+        std::vector<Section> sections;
+    };
+
+    double getSnrDb(const std::vector<double>& reference, const std::vector<float>& output)
+    {
+        double signal = 0, noise = 0;
+
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            signal += reference[i] * reference[i];
+            noise += (reference[i] - output[i]) * (reference[i] - output[i]);
+        }
+
+        return noise > 0 ? 10.0 * std::log10(signal / noise) : INFINITY;
+    }
+
+    template <typename Callback>
+    double getMegaSamplesPerSecond(Callback&& processAll)
+    {
+        double fastest = 1e30;
+
+        for (int run = 0; run < numTimingRuns; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            processAll();
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            fastest = std::min(fastest, elapsed);
+        }
+
+        return numSamples / fastest / 1e6;
+    }
+
+    void printResult(const char* path, double snr, double throughput, const char* checksum = "")
+    {
+        std::printf("  %-26s %8.1f dB %10.1f Ms/s  %s\n", path, snr, throughput, checksum);
+    }
+
+    template <typename Format>
+    void runFixedPoint(const char* path, const ChainCoefficients& coefficients, bool useErrorFeedback,
+                       const std::vector<float>& input, const std::vector<double>& reference, uint64_t expectedChecksum = 0)
+    {
+        using Chain = FixedPointMonoChain<Format>;
+        using Sample = typename Format::Sample;
+
+        Chain chain;
+        chain.setCoefficients(coefficients, useErrorFeedback);
+
+        std::vector<Sample> quantisedInput(input.size()), samples(input.size());
+
+        for (size_t i = 0; i < input.size(); ++i)
+            quantisedInput[i] = Chain::fromFloat(input[i]);
+
+        auto throughput = getMegaSamplesPerSecond([&]
+        {
+            samples = quantisedInput;
+            chain.reset();
+
+            for (int start = 0; start < numSamples; start += blockSize)
+                chain.process(samples.data() + start, std::min(blockSize, numSamples - start));
+        });
+
+        std::vector<float> output(samples.size());
+
+        for (size_t i = 0; i < samples.size(); ++i)
+            output[i] = Chain::toFloat(samples[i]);
+
+        // only the error feedback runs have a stored checksum, that's how the plugin runs the chain
+        auto actualChecksum = getChecksum(samples);
+        char checksum[48];
+        std::snprintf(checksum, sizeof(checksum), "%016llx%s", (unsigned long long) actualChecksum,
+                      expectedChecksum == 0 ? "" : actualChecksum == expectedChecksum ? " ok" : " CHANGED");
+        printResult(path, getSnrDb(reference, output), throughput, checksum);
+    }
+}
+
+int main()
+{
+    auto input = makeTestSignal();
+
+    std::printf("%d samples at %.0f Hz, processed in blocks of %d\n\n", numSamples, sampleRate, blockSize);
+    std::printf("  %-26s %11s %15s  %s\n", "path", "SNR", "throughput", "checksum");
+
+    for (auto& scenario : scenarios)
+    {
+        auto coefficients = makeCoefficients(scenario);
+
+        std::printf("\n%s (%d + 1 + %d sections)\n", scenario.name,
+                    coefficients.lowCut.numSections, coefficients.highCut.numSections);
+
+        std::vector<double> reference(input.begin(), input.end());
+        FloatingPointChain<double>(coefficients).process(reference.data(), numSamples);
+
+        FloatingPointChain<float> chain(coefficients);
+        std::vector<float> output;
+
+        auto throughput = getMegaSamplesPerSecond([&]
+        {
+            output = input;
+            chain.reset();
+
+            for (int start = 0; start < numSamples; start += blockSize)
+                chain.process(output.data() + start, std::min(blockSize, numSamples - start));
+        });
+
+        printResult("float", getSnrDb(reference, output), throughput);
+
+        runFixedPoint<Q31>("Q31 error feedback", coefficients, true, input, reference, scenario.q31Checksum);
+        runFixedPoint<Q31>("Q31 plain truncation", coefficients, false, input, reference);
+        runFixedPoint<Q15>("Q15 error feedback", coefficients, true, input, reference, scenario.q15Checksum);
+        runFixedPoint<Q15>("Q15 plain truncation", coefficients, false, input, reference);
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    The scenarios, test signal and checksum shared by the fixed-point benchmark
+    and Tests/NVSEQTests.cpp. The fixed-point outputs are pure integer maths,
+    so the checksums stored here have to come out the same on every platform
+    the chain is deployed to. If a change to the chain is meant to alter its
+    output, run the benchmark and copy the new checksums in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BiquadDesign.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace FixedPointScenarios
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numSamples = 48000 * 5;
+    constexpr int blockSize = 512;
+
+    struct Scenario
+    {
+        const char* name;
+        CutFamily lowCutFamily;
+        double lowCutFreq;
+        int lowCutOrder;
+        double peakFreq, peakQ, peakGainDb;
+        CutFamily highCutFamily;
+        double highCutFreq;
+        int highCutOrder;
+        // of the chain's output with error feedback on, the way the plugin runs it
+        uint64_t q31Checksum, q15Checksum;
+    };
+
+    inline const Scenario scenarios[] =
+    {
+        { "plugin defaults", CutFamily_Butterworth, 20.0, 2, 1000.0, 0.7, 0.0, CutFamily_Butterworth, 20000.0, 2, 0x6003956dbf610c2dull, 0x1a8d3dbd94f95778ull },
+        { "rumble + presence", CutFamily_Elliptic, 80.0, 8, 3000.0, 1.0, 6.0, CutFamily_Butterworth, 12000.0, 4, 0xa620d10cda08a5deull, 0x7b60e84e6fcd8c3cull },
+        { "steep cuts", CutFamily_Butterworth, 30.0, 16, 250.0, 2.0, -6.0, CutFamily_Chebyshev, 16000.0, 8, 0x863c911be2ac9019ull, 0xcba5995d2e17a5e1ull },
+    };
+
+    inline ChainCoefficients makeCoefficients(const Scenario& scenario)
+    {
+        ChainCoefficients coefficients;
+        coefficients.lowCut = designCutFilter(scenario.lowCutFamily, true, scenario.lowCutFreq, sampleRate, scenario.lowCutOrder);
+        coefficients.peak = designPeakSection(scenario.peakFreq, sampleRate, scenario.peakQ, std::pow(10.0, scenario.peakGainDb / 20.0));
+        coefficients.highCut = designCutFilter(scenario.highCutFamily, false, scenario.highCutFreq, sampleRate, scenario.highCutOrder);
+        return coefficients;
+    }
+
+    // white noise at -18 dBFS RMS over a -12 dBFS sine, from a fixed seed so every run matches
+    inline std::vector<float> makeTestSignal()
+    {
+        std::vector<float> signal((size_t) numSamples);
+        uint32_t seed = 0x1234567u;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            auto noise = (double) seed / 4294967296.0 * 2.0 - 1.0;
+            auto sine = std::sin(2.0 * 3.14159265358979323846 * 997.0 * i / sampleRate);
+
+            signal[(size_t) i] = (float) (0.125 * std::sqrt(3.0) * noise + 0.25 * sine);
+        }
+
+        return signal;
+    }
+
+    template <typename SampleType>
+    uint64_t getChecksum(const std::vector<SampleType>& samples)
+    {
+        // FNV-1a over the raw sample bytes
+        uint64_t hash = 14695981039346656037ull;
+
+        for (auto sample : samples)
+        {
+            auto bits = (uint64_t) (int64_t) sample;
+
+            for (size_t byte = 0; byte < sizeof(SampleType); ++byte)
+            {
+                hash ^= (bits >> (8 * byte)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        }
+
+        return hash;
+    }
+}
@@ -0,0 +1,425 @@
+/*
+  ==============================================================================
+
+    Filter design maths for the EQ.
+
+    The cut filters are designed as analog lowpass prototypes with their
+    passband edge at 1 rad/s, transformed to a high pass where needed and then
+    moved into the digital domain with a pre-warped bilinear transform. The
+    elliptic prototype follows Orfanidis, "Lecture Notes on Elliptic Filter
+    Design" (2006).
+
+  ==============================================================================
+*/
+
+#include "BiquadDesign.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace
+{
+    using Complex = std::complex<double>;
+
+    constexpr double pi = 3.14159265358979323846;
+
+    // ripple allowed in the passband of the Chebyshev and elliptic designs
+    constexpr double passbandRippleDb = 0.5;
+
+    // one second order section of the analog prototype. the section has the poles
+    // pole and conj(pole), for a real pole that means the same pole twice
+    struct AnalogSection
+    {
+        Complex pole;
+        // zero of 0 means both zeros are at infinity, otherwise they sit at +-j * zeroFrequency
+        double zeroFrequency{0};
+    };
+
+    struct AnalogPrototype
+    {
+        std::vector<AnalogSection> sections;
+        // gain of the prototype at DC, which isn't 1 for even order ripple designs
+        double passbandGain{1};
+    };
+
+    //==============================================================================
+    // the poles of a Butterworth filter that sit in the upper half of the s-plane, plus the
+    // real pole for odd orders
+    std::vector<Complex> getButterworthPoles(int order)
+    {
+        std::vector<Complex> poles;
+
+        for (int k = 1; k <= order / 2; ++k)
+            poles.push_back(std::polar(1.0, pi * (2 * k + order - 1) / (2.0 * order)));
+
+        if (order % 2 == 1)
+            poles.push_back(-1.0);
+
+        return poles;
+    }
+
+    AnalogPrototype designButterworth(int order)
+    {
+        AnalogPrototype prototype;
+
+        for (auto pole : getButterworthPoles(order))
+            prototype.sections.push_back({pole});
+
+        return prototype;
+    }
+
+    // a Linkwitz-Riley filter is a Butterworth of half the order applied twice
+    AnalogPrototype designLinkwitzRiley(int order)
+    {
+        AnalogPrototype prototype;
+
+        for (auto pole : getButterworthPoles(order / 2))
+        {
+            prototype.sections.push_back({pole});
+
+            // a real pole only needs one section to hold both copies of it
+            if (pole.imag() != 0)
+                prototype.sections.push_back({pole});
+        }
+
+        return prototype;
+    }
+
+    AnalogPrototype designChebyshev(int order)
+    {
+        AnalogPrototype prototype;
+
+        auto epsilon = std::sqrt(std::pow(10.0, passbandRippleDb / 10.0) - 1.0);
+        auto mu = std::asinh(1.0 / epsilon) / order;
+
+        for (int k = 1; k <= order / 2; ++k)
+        {
+            auto theta = pi * (2 * k - 1) / (2.0 * order);
+            prototype.sections.push_back({{-std::sinh(mu) * std::sin(theta), std::cosh(mu) * std::cos(theta)}});
+        }
+
+        prototype.passbandGain = 1.0 / std::sqrt(1.0 + epsilon * epsilon);
+        return prototype;
+    }
+
+    //==============================================================================
+    // descending Landen sequence of moduli, used to evaluate the Jacobi elliptic functions
+    std::vector<double> getLandenSequence(double k)
+    {
+        std::vector<double> moduli;
+
+        while (k > 1e-15 && moduli.size() < 16)
+        {
+            k = k / (1.0 + std::sqrt(1.0 - k * k));
+            k *= k;
+            moduli.push_back(k);
+        }
+
+        return moduli;
+    }
+
+    // Jacobi cd and sn functions with their argument normalised to the quarter period, so cd(u K, k)
+    Complex cde(Complex u, double k)
+    {
+        auto moduli = getLandenSequence(k);
+        auto w = std::cos(u * pi / 2.0);
+
+        for (auto it = moduli.rbegin(); it != moduli.rend(); ++it)
+            w = (1.0 + *it) * w / (1.0 + *it * w * w);
+
+        return w;
+    }
+
+    Complex sne(Complex u, double k)
+    {
+        auto moduli = getLandenSequence(k);
+        auto w = std::sin(u * pi / 2.0);
+
+        for (auto it = moduli.rbegin(); it != moduli.rend(); ++it)
+            w = (1.0 + *it) * w / (1.0 + *it * w * w);
+
+        return w;
+    }
+
+    // inverse of sne
+    Complex asne(Complex w, double k)
+    {
+        auto moduli = getLandenSequence(k);
+        auto previous = k;
+
+        for (auto modulus : moduli)
+        {
+            w = w / (1.0 + std::sqrt(1.0 - w * w * previous * previous)) * 2.0 / (1.0 + modulus);
+            previous = modulus;
+        }
+
+        return 1.0 - 2.0 / pi * std::acos(w);
+    }
+
+    // solves the degree equation for the selectivity modulus of an elliptic filter
+    double getEllipticSelectivity(int order, double discrimination)
+    {
+        auto complement = std::sqrt(1.0 - discrimination * discrimination);
+        auto product = 1.0;
+
+        for (int i = 1; i <= order / 2; ++i)
+            product *= sne((2.0 * i - 1.0) / order, complement).real();
+
+        auto selectivityComplement = std::pow(complement, order) * std::pow(product, 4);
+        return std::sqrt(1.0 - selectivityComplement * selectivityComplement);
+    }
+
+    AnalogPrototype designElliptic(int order, double stopbandAttenuationDb)
+    {
+        AnalogPrototype prototype;
+
+        auto passbandEpsilon = std::sqrt(std::pow(10.0, passbandRippleDb / 10.0) - 1.0);
+        auto stopbandEpsilon = std::sqrt(std::pow(10.0, stopbandAttenuationDb / 10.0) - 1.0);
+        auto discrimination = passbandEpsilon / stopbandEpsilon;
+        auto selectivity = getEllipticSelectivity(order, discrimination);
+
+        auto v0 = (Complex(0, -1) * asne(Complex(0, 1.0 / passbandEpsilon), discrimination)).real() / order;
+
+        for (int i = 1; i <= order / 2; ++i)
+        {
+            auto u = (2.0 * i - 1.0) / order;
+            auto zeta = cde(u, selectivity).real();
+            auto pole = Complex(0, 1) * cde(Complex(u, -v0), selectivity);
+
+            prototype.sections.push_back({{-std::abs(pole.real()), std::abs(pole.imag())}, 1.0 / (selectivity * zeta)});
+        }
+
+        prototype.passbandGain = 1.0 / std::sqrt(1.0 + passbandEpsilon * passbandEpsilon);
+        return prototype;
+    }
+
+    AnalogPrototype designPrototype(CutFamily family, int order, double stopbandAttenuationDb)
+    {
+        switch (family)
+        {
+            case CutFamily_Chebyshev:       return designChebyshev(order);
+            case CutFamily_Elliptic:        return designElliptic(order, std::max(stopbandAttenuationDb, minimumStopbandAttenuationDb));
+            case CutFamily_LinkwitzRiley:   return designLinkwitzRiley(order);
+            case CutFamily_Butterworth:
+            default:                        return designButterworth(order);
+        }
+    }
+
+    // how far down the lowpass prototype is at frequency (in rad/s, so relative to its passband edge).
+    // a high pass is the same prototype with frequency turned upside down, so this covers both
+    double getPrototypeAttenuationDb(const AnalogPrototype& prototype, double frequency)
+    {
+        auto s = Complex(0, frequency);
+        auto gain = prototype.passbandGain;
+
+        for (auto& section : prototype.sections)
+        {
+            // each section has unity gain at DC, like the biquads toBiquad makes from it
+            auto numerator = Complex(std::norm(section.pole));
+
+            if (section.zeroFrequency != 0)
+                numerator *= (s * s + section.zeroFrequency * section.zeroFrequency) / (section.zeroFrequency * section.zeroFrequency);
+
+            gain *= std::abs(numerator / ((s - section.pole) * (s - std::conj(section.pole))));
+        }
+
+        return -20.0 * std::log10(gain);
+    }
+
+    //==============================================================================
+    // bilinear transform of s into z, with s already scaled so that s = (1 - z^-1) / (1 + z^-1)
+    Complex toDigital(Complex s)
+    {
+        return (1.0 + s) / (1.0 - s);
+    }
+
+    // coefficients of (1 - root z^-1)(1 - conj(root) z^-1)
+    std::array<double, 3> expandConjugatePair(Complex root)
+    {
+        return {1.0, -2.0 * root.real(), std::norm(root)};
+    }
+
+    BiquadSection toBiquad(const AnalogSection& analog, bool isHighPass, double warpedFrequency)
+    {
+        // a lowpass just gets scaled to the cutoff, a high pass swaps s for 1 / s, which turns
+        // zeros at infinity into zeros at DC
+        Complex pole, zero;
+        bool zerosAtInfinity = analog.zeroFrequency == 0;
+
+        if (isHighPass)
+        {
+            pole = warpedFrequency / analog.pole;
+            zero = zerosAtInfinity ? Complex(0) : Complex(0, warpedFrequency / analog.zeroFrequency);
+        }
+        else
+        {
+            pole = warpedFrequency * analog.pole;
+            zero = zerosAtInfinity ? Complex(0) : Complex(0, warpedFrequency * analog.zeroFrequency);
+        }
+
+        auto denominator = expandConjugatePair(toDigital(pole));
+        auto numerator = expandConjugatePair(zerosAtInfinity && ! isHighPass ? Complex(-1) : toDigital(zero));
+
+        // normalise the section to unity gain in its passband, at DC for a lowpass or Nyquist for a high pass
+        auto sign = isHighPass ? -1.0 : 1.0;
+        auto gain = (denominator[0] + sign * denominator[1] + denominator[2])
+                  / (numerator[0] + sign * numerator[1] + numerator[2]);
+
+        BiquadSection section;
+        section.b0 = numerator[0] * gain;
+        section.b1 = numerator[1] * gain;
+        section.b2 = numerator[2] * gain;
+        section.a1 = denominator[1];
+        section.a2 = denominator[2];
+        return section;
+    }
+}
+
+//==============================================================================
+namespace
+{
+    int getValidCutOrder(int order)
+    {
+        return std::clamp(order - order % 2, 2, maxCutOrder);
+    }
+
+    double getWarpedFrequency(double frequency, double sampleRate)
+    {
+        // keep the cutoff clear of Nyquist, where the pre-warping blows up
+        frequency = std::clamp(frequency, 1.0, sampleRate * 0.49);
+        return std::tan(pi * frequency / sampleRate);
+    }
+}
+
+CutCoefficients designCutFilter(CutFamily family, bool isHighPass, double frequency, double sampleRate, int order,
+                                double stopbandAttenuationDb)
+{
+    order = getValidCutOrder(order);
+    auto warpedFrequency = getWarpedFrequency(frequency, sampleRate);
+
+    auto prototype = designPrototype(family, order, stopbandAttenuationDb);
+
+    CutCoefficients coefficients;
+    coefficients.numSections = static_cast<int>(prototype.sections.size());
+
+    for (int i = 0; i < coefficients.numSections; ++i)
+        coefficients.sections[(size_t) i] = toBiquad(prototype.sections[(size_t) i], isHighPass, warpedFrequency);
+
+    auto& first = coefficients.sections.front();
+    first.b0 *= prototype.passbandGain;
+    first.b1 *= prototype.passbandGain;
+    first.b2 *= prototype.passbandGain;
+
+    return coefficients;
+}
+
+int getMinimumCutOrder(CutFamily family, double attenuationDb)
+{
+    // Butterworth and Linkwitz-Riley fall at 6 dB/Oct per order, near enough from the first octave
+    if (family == CutFamily_Butterworth || family == CutFamily_LinkwitzRiley)
+        return getValidCutOrder(static_cast<int>(std::lround(attenuationDb / 6.0)));
+
+    // the ripple designs fall faster than that, so try each order on the analog prototype, an octave
+    // past its passband edge. the bilinear transform only ever squeezes the stopband in closer to the
+    // cutoff, so the digital cut is at least as far down an octave out wherever it sits, and measuring
+    // the prototype keeps the order from changing as the cutoff moves up towards Nyquist
+    for (int order = 2; order < maxCutOrder; order += 2)
+        if (getPrototypeAttenuationDb(designPrototype(family, order, attenuationDb), 2.0) >= attenuationDb)
+            return order;
+
+    return maxCutOrder;
+}
+
+BiquadSection designPeakSection(double frequency, double sampleRate, double quality, double gainFactor)
+{
+    auto A = std::sqrt(std::max(0.0, gainFactor));
+    auto omega = 2.0 * pi * frequency / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+    auto c2 = -2.0 * std::cos(omega);
+    auto alphaTimesA = alpha * A;
+    auto alphaOverA = alpha / A;
+    auto a0 = 1.0 + alphaOverA;
+
+    return { (1.0 + alphaTimesA) / a0, c2 / a0, (1.0 - alphaTimesA) / a0, c2 / a0, (1.0 - alphaOverA) / a0 };
+}
+
+CutCoefficients designLinkwitzRileyAllpass(double frequency, double sampleRate, int order)
+{
+    // a Linkwitz-Riley pair built from a Butterworth B(s) sums to B(-s) / B(s), so the allpass has
+    // the Butterworth poles and each section's numerator is its denominator reversed
+    auto warpedFrequency = getWarpedFrequency(frequency, sampleRate);
+    auto poles = getButterworthPoles(getValidCutOrder(order) / 2);
+
+    CutCoefficients coefficients;
+    coefficients.numSections = static_cast<int>(poles.size());
+
+    for (size_t i = 0; i < poles.size(); ++i)
+    {
+        auto pole = toDigital(warpedFrequency * poles[i]);
+        auto& section = coefficients.sections[i];
+
+        if (poles[i].imag() != 0)
+        {
+            auto denominator = expandConjugatePair(pole);
+            section = { denominator[2], denominator[1], denominator[0], denominator[1], denominator[2] };
+        }
+        else
+        {
+            // the real pole of an odd order Butterworth only needs a first order allpass
+            section = { -pole.real(), 1.0, 0.0, -pole.real(), 0.0 };
+        }
+    }
+
+    return coefficients;
+}
+
+bool isLinkwitzRileyPairInverted(int order)
+{
+    return (getValidCutOrder(order) / 2) % 2 == 1;
+}
+
+int getReducedCutOrder(int order)
+{
+    return std::max(2, order / 4 * 2);
+}
+
+int getSettlingSamples(const CutCoefficients& coefficients, double sampleRate)
+{
+    // past a second only the lowest cutoffs are still ringing, and only just
+    constexpr double settlingDecayDb = 80.0;
+    constexpr double maxSettlingSeconds = 1.0;
+
+
+    auto radius = 0.0;
+
+    for (int i = 0; i < coefficients.numSections; ++i)
+    {
+        // the poles of 1 + a1 z^-1 + a2 z^-2, a conjugate pair or two real poles
+        auto& section = coefficients.sections[(size_t) i];
+        auto discriminant = section.a1 * section.a1 - 4.0 * section.a2;
+
+        radius = std::max(radius, discriminant < 0 ? std::sqrt(section.a2)
+                                                   : (std::abs(section.a1) + std::sqrt(discriminant)) / 2.0);
+    }
+
+    if (radius <= 0)
+        return 0;
+
+    auto maxSamples = static_cast<int>(std::lround(maxSettlingSeconds * sampleRate));
+
+    if (radius >= 1)
+        return maxSamples;
+
+    return std::min(maxSamples, static_cast<int>(std::ceil(settlingDecayDb / (-20.0 * std::log10(radius)))));
+}
+
+double getMagnitudeForFrequency(const BiquadSection& section, double frequency, double sampleRate)
+{
+    auto z = std::polar(1.0, -2.0 * pi * frequency / sampleRate);   // z^-1
+    auto numerator = section.b0 + z * (section.b1 + z * section.b2);
+    auto denominator = 1.0 + z * (section.a1 + z * section.a2);
+
+    return std::abs(numerator / denominator);
+}
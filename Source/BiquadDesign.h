@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    Filter design maths for the EQ. Nothing in here depends on JUCE, so the
+    same designs can be shared with builds of the EQ that don't use it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+
+// the analog prototypes that the low-cut and high-cut filters can be built from
+enum CutFamily
+{
+    CutFamily_Butterworth,
+    CutFamily_Chebyshev,
+    CutFamily_Elliptic,
+    CutFamily_LinkwitzRiley
+};
+
+// a single second order section, normalised so that a0 is always 1
+struct BiquadSection
+{
+    double b0{1}, b1{0}, b2{0}, a1{0}, a2{0};
+};
+
+// eight second order sections gives us a 16th order (96 dB/Oct) cut
+constexpr int maxCutSections = 8;
+constexpr int maxCutOrder = maxCutSections * 2;
+
+// the elliptic design never has its stopband any closer to the passband than this
+constexpr double minimumStopbandAttenuationDb = 80.0;
+
+struct CutCoefficients
+{
+    std::array<BiquadSection, maxCutSections> sections;
+    int numSections{1};
+};
+
+// everything needed to run one channel of the EQ
+struct ChainCoefficients
+{
+    CutCoefficients lowCut;
+    BiquadSection peak;
+    CutCoefficients highCut;
+    // stages that are switched off, or set where they wouldn't change anything, drop out of the chain
+    bool lowCutActive{true}, peakActive{true}, highCutActive{true};
+    // whether each stage is switched in at all. one that's switched in but not active is only
+    // sitting where it's neutral, so what it puts out is near enough its input
+    bool lowCutSwitchedOn{true}, peakSwitchedOn{true}, highCutSwitchedOn{true};
+};
+
+// the filters that split the chain into low, mid and high bands on top of the main low-cut and
+// high-cut, which act as the Linkwitz-Riley crossover points. with the high pass of an odd
+// Linkwitz-Riley pair (order 2, 6, 10 or 14) the bands sum to an allpass only once inverted
+struct CrossoverCoefficients
+{
+    // Linkwitz-Riley lowpass at the low-cut frequency
+    CutCoefficients lowBand;
+    // the allpass the high-cut crossover applies to everything above the low band,
+    // so that the low band stays in phase with the other two
+    CutCoefficients lowBandAllpass;
+    // Linkwitz-Riley high pass at the high-cut frequency
+    CutCoefficients highBand;
+    bool invertLowBand{false};
+    bool invertHighBand{false};
+};
+
+// designs a low-cut (high pass) or high-cut (low pass) as a cascade of second order sections.
+// order has to be even and no larger than maxCutOrder. Chebyshev and elliptic designs have
+// their passband edge at frequency, the others are -3 dB (Linkwitz-Riley -6 dB) there.
+// the elliptic stopband sits stopbandAttenuationDb down, or minimumStopbandAttenuationDb if that's further.
+// the sections come out most resonant first, and each one has unity gain in the passband.
+// this allocates, so call it from the message thread rather than the audio thread
+CutCoefficients designCutFilter(CutFamily family, bool isHighPass, double frequency, double sampleRate, int order,
+                                double stopbandAttenuationDb = minimumStopbandAttenuationDb);
+
+// the lowest order at which a cut is at least attenuationDb down one octave past its cutoff, wherever
+// the cutoff is. that's order / 6 dB for Butterworth and Linkwitz-Riley, the ripple designs get there
+// with fewer sections. pass the same attenuationDb on to designCutFilter so the elliptic stopband is
+// deep enough for it
+int getMinimumCutOrder(CutFamily family, double attenuationDb);
+
+// the same peak filter as juce::dsp::IIR::Coefficients::makePeakFilter, gainFactor is linear
+BiquadSection designPeakSection(double frequency, double sampleRate, double quality, double gainFactor);
+
+// the allpass that a Linkwitz-Riley lowpass and high pass of the same order sum to
+CutCoefficients designLinkwitzRileyAllpass(double frequency, double sampleRate, int order);
+
+// true when the high pass of a Linkwitz-Riley pair has to be inverted for the pair to sum flat
+bool isLinkwitzRileyPairInverted(int order);
+
+// half the order, rounded down to an even order but at least 2. what a cut runs at when the
+// quality governor asks for reduced order
+int getReducedCutOrder(int order);
+
+// how long a cascade started from silence takes to settle: until its slowest decaying pole has
+// died away by 80 dB, but never more than a second. the lower a cut's cutoff, the longer that is
+int getSettlingSamples(const CutCoefficients& coefficients, double sampleRate);
+
+double getMagnitudeForFrequency(const BiquadSection& section, double frequency, double sampleRate);
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    A fixed-point version of the EQ's MonoChain.
+
+  ==============================================================================
+*/
+
+#include "FixedPointChain.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // how much the rounding noise of a section is amplified at its output when the error is fed
+    // back through 1 + feedback1 z^-1 + feedback2 z^-2. this is the power gain of
+    // (1 + feedback1 z^-1 + feedback2 z^-2) / (1 + a1 z^-1 + a2 z^-2) in closed form, from the
+    // autocorrelation of the second order all-pole part, so it costs the same however close to
+    // the unit circle the poles are
+    double getNoiseGain(double a1, double a2, int feedback1, int feedback2)
+    {
+        auto denominator = (1.0 - a2) * ((1.0 + a2) * (1.0 + a2) - a1 * a1);
+
+        // poles that quantised onto or past the unit circle amplify the noise without limit
+        if (denominator <= 0 || 1.0 + a2 <= 0)
+            return std::numeric_limits<double>::infinity();
+
+        auto r0 = (1.0 + a2) / denominator;
+        auto r1 = -a1 * r0 / (1.0 + a2);
+        auto r2 = -a1 * r1 - a2 * r0;
+
+        double f0 = 1, f1 = feedback1, f2 = feedback2;
+
+        return (f0 * f0 + f1 * f1 + f2 * f2) * r0
+             + 2.0 * (f0 * f1 + f1 * f2) * r1
+             + 2.0 * f0 * f2 * r2;
+    }
+}
+
+template <typename Format>
+void FixedPointBiquad<Format>::setCoefficients(const BiquadSection& section, bool useErrorFeedback)
+{
+    const double coefficients[] = { section.b0, section.b1, section.b2, section.a1, section.a2 };
+
+    double largest = 0, total = 3;   // the error feedback adds at most three more units
+
+    for (auto coefficient : coefficients)
+    {
+        largest = std::max(largest, std::abs(coefficient));
+        total += std::abs(coefficient);
+    }
+
+    // use as many fractional bits as we can while the largest coefficient still fits, and a full
+    // scale input can't overflow the 64 bit accumulator
+    constexpr int coefficientDigits = std::numeric_limits<Coefficient>::digits;
+    auto previousCoefficientBits = coefficientBits;
+    coefficientBits = coefficientDigits;
+
+    while (coefficientBits > 0
+           && (std::ldexp(largest, coefficientBits) >= std::ldexp(1.0, coefficientDigits)
+               || std::ldexp(total, coefficientBits + Format::fractionalBits) >= std::ldexp(1.0, 63)))
+        --coefficientBits;
+
+    errorMask = ((int64_t) 1 << coefficientBits) - 1;
+
+    auto quantise = [this] (double coefficient)
+    {
+        auto scaled = std::llround(std::ldexp(coefficient, coefficientBits));
+        return (Coefficient) std::clamp<long long>(scaled, std::numeric_limits<Coefficient>::min(), std::numeric_limits<Coefficient>::max());
+    };
+
+    b0 = quantise(section.b0);
+    b1 = quantise(section.b1);
+    b2 = quantise(section.b2);
+    a1 = quantise(section.a1);
+    a2 = quantise(section.a2);
+
+    errorFeedback1 = 0;
+    errorFeedback2 = 0;
+
+    if (useErrorFeedback)
+    {
+        // try every small integer weighting and keep the quietest, using the poles we'll really get
+        auto quantisedA1 = std::ldexp((double) a1, -coefficientBits);
+        auto quantisedA2 = std::ldexp((double) a2, -coefficientBits);
+        auto quietest = getNoiseGain(quantisedA1, quantisedA2, 0, 0);
+
+        for (int feedback1 = -2; feedback1 <= 2; ++feedback1)
+        {
+            for (int feedback2 = -1; feedback2 <= 1; ++feedback2)
+            {
+                auto noiseGain = getNoiseGain(quantisedA1, quantisedA2, feedback1, feedback2);
+
+                if (noiseGain < quietest)
+                {
+                    quietest = noiseGain;
+                    errorFeedback1 = feedback1;
+                    errorFeedback2 = feedback2;
+                }
+            }
+        }
+    }
+
+    // the filter keeps running through a coefficient change, only the rounding error has to go
+    // if it's now measured in a different number of bits. it's less than one LSB, so nobody hears it
+    if (coefficientBits != previousCoefficientBits)
+        error1 = error2 = 0;
+}
+
+template <typename Format>
+void FixedPointBiquad<Format>::reset() noexcept
+{
+    x1 = x2 = y1 = y2 = 0;
+    error1 = error2 = 0;
+}
+
+//==============================================================================
+template <typename Format>
+void FixedPointMonoChain<Format>::setCoefficients(const ChainCoefficients& chainCoefficients, bool useErrorFeedback)
+{
+    // stages that have dropped out of the chain just get no sections
+    auto newNumLowCutSections = chainCoefficients.lowCutActive ? std::clamp(chainCoefficients.lowCut.numSections, 0, maxCutSections) : 0;
+    auto newNumHighCutSections = chainCoefficients.highCutActive ? std::clamp(chainCoefficients.highCut.numSections, 0, maxCutSections) : 0;
+
+    // a section that wasn't running starts again from silence
+    for (int i = numLowCutSections; i < newNumLowCutSections; ++i)
+        lowCut[(size_t) i].reset();
+
+    for (int i = numHighCutSections; i < newNumHighCutSections; ++i)
+        highCut[(size_t) i].reset();
+
+    if (chainCoefficients.peakActive && ! isPeakActive)
+        peak.reset();
+
+    numLowCutSections = newNumLowCutSections;
+    numHighCutSections = newNumHighCutSections;
+    isPeakActive = chainCoefficients.peakActive;
+
+    for (int i = 0; i < numLowCutSections; ++i)
+        lowCut[(size_t) i].setCoefficients(chainCoefficients.lowCut.sections[(size_t) i], useErrorFeedback);
+
+    peak.setCoefficients(chainCoefficients.peak, useErrorFeedback);
+
+    for (int i = 0; i < numHighCutSections; ++i)
+        highCut[(size_t) i].setCoefficients(chainCoefficients.highCut.sections[(size_t) i], useErrorFeedback);
+}
+
+template <typename Format>
+void FixedPointMonoChain<Format>::reset() noexcept
+{
+    for (auto& section : lowCut)
+        section.reset();
+
+    peak.reset();
+
+    for (auto& section : highCut)
+        section.reset();
+}
+
+template <typename Format>
+typename Format::Sample FixedPointMonoChain<Format>::fromFloat(float sample) noexcept
+{
+    auto scaled = std::llround(std::ldexp((double) sample, Format::fractionalBits));
+    return (Sample) std::clamp<long long>(scaled, std::numeric_limits<Sample>::min(), std::numeric_limits<Sample>::max());
+}
+
+template <typename Format>
+float FixedPointMonoChain<Format>::toFloat(Sample sample) noexcept
+{
+    return (float) std::ldexp((double) sample, -Format::fractionalBits);
+}
+
+template class FixedPointBiquad<Q31>;
+template class FixedPointBiquad<Q15>;
+template class FixedPointMonoChain<Q31>;
+template class FixedPointMonoChain<Q15>;
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    A fixed-point version of the EQ's MonoChain for boxes without fast float
+    hardware. It runs the same designs as the plugin, only quantised, and is
+    plain C++ so it can be built and checked against the float path anywhere.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BiquadDesign.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Q1.31 samples and coefficients
+struct Q31
+{
+    using Sample = int32_t;
+    using Coefficient = int32_t;
+    static constexpr int fractionalBits = 31;
+};
+
+// Q1.15 samples with 32 bit coefficients and a 64 bit accumulator. 16 bit coefficients can't
+// place the poles of a 20 Hz low-cut at all, they end up on DC and the section integrates
+struct Q15
+{
+    using Sample = int16_t;
+    using Coefficient = int32_t;
+    static constexpr int fractionalBits = 15;
+};
+
+// a direct form I biquad with error feedback. the bits lost when the accumulator is rounded
+// back to a sample are fed back through small integer weights picked to cancel most of the
+// gain 1 / A(z) would otherwise give that noise. for the low-cut, whose poles sit right next
+// to DC, that's the difference between usable and not
+template <typename Format>
+class FixedPointBiquad
+{
+public:
+    using Sample = typename Format::Sample;
+    using Coefficient = typename Format::Coefficient;
+
+    // the state carries on through a coefficient change, so the audio doesn't click. only reset() clears it
+    void setCoefficients(const BiquadSection& section, bool useErrorFeedback);
+    void reset() noexcept;
+
+    Sample processSample(Sample input) noexcept
+    {
+        int64_t accumulator = (int64_t) b0 * input
+                            + (int64_t) b1 * x1
+                            + (int64_t) b2 * x2
+                            - (int64_t) a1 * y1
+                            - (int64_t) a2 * y2
+                            - errorFeedback1 * error1
+                            - errorFeedback2 * error2;
+
+        // arithmetic shift rounds towards minus infinity, so the error is always the positive low bits
+        auto output = accumulator >> coefficientBits;
+        auto error = accumulator & errorMask;
+
+        // if the output clips the error means nothing, so stop it winding the feedback up
+        if (output > std::numeric_limits<Sample>::max())
+        {
+            output = std::numeric_limits<Sample>::max();
+            error = 0;
+        }
+        else if (output < std::numeric_limits<Sample>::min())
+        {
+            output = std::numeric_limits<Sample>::min();
+            error = 0;
+        }
+
+        x2 = x1;
+        x1 = input;
+        y2 = y1;
+        y1 = (Sample) output;
+        error2 = error1;
+        error1 = error;
+
+        return y1;
+    }
+
+private:
+    Coefficient b0{0}, b1{0}, b2{0}, a1{0}, a2{0};
+    // how many fractional bits the coefficients have, which leaves room for the largest one
+    int coefficientBits{Format::fractionalBits};
+    int64_t errorMask{0};
+    int64_t errorFeedback1{0}, errorFeedback2{0};
+
+    Sample x1{0}, x2{0}, y1{0}, y2{0};
+    int64_t error1{0}, error2{0};
+};
+
+// the fixed-point equivalent of MonoChain: low-cut, peak and high-cut
+template <typename Format>
+class FixedPointMonoChain
+{
+public:
+    using Sample = typename Format::Sample;
+
+    void setCoefficients(const ChainCoefficients& chainCoefficients, bool useErrorFeedback = true);
+    void reset() noexcept;
+
+    void process(Sample* samples, int numSamples) noexcept
+    {
+        // the cut sections run least resonant first, so the signal between sections never peaks
+        // above what comes out of the whole cut and clips on the way through
+        for (int i = numLowCutSections; --i >= 0;)
+            processSection(lowCut[(size_t) i], samples, numSamples);
+
+        if (isPeakActive)
+            processSection(peak, samples, numSamples);
+
+        for (int i = numHighCutSections; --i >= 0;)
+            processSection(highCut[(size_t) i], samples, numSamples);
+    }
+
+    // conversion to and from float, rounding to nearest and saturating at full scale
+    static Sample fromFloat(float sample) noexcept;
+    static float toFloat(Sample sample) noexcept;
+
+private:
+    static void processSection(FixedPointBiquad<Format>& section, Sample* samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = section.processSample(samples[i]);
+    }
+
+    std::array<FixedPointBiquad<Format>, maxCutSections> lowCut, highCut;
+    FixedPointBiquad<Format> peak;
+    int numLowCutSections{0}, numHighCutSections{0};
+    bool isPeakActive{true};
+};
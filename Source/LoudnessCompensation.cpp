@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    Works out the level compensation for the EQ from its magnitude response.
+
+  ==============================================================================
+*/
+
+#include "LoudnessCompensation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    // points on the log frequency axis between 20 Hz and 20 kHz. pink noise has the same energy
+    // at each of them, so the average needs no extra weighting
+    constexpr int numFrequencies = 256;
+
+    // the two stages of the BS.1770 K-weighting filter, redesigned for any sample rate the way
+    // libebur128 does it rather than using the 48 kHz coefficients from the standard
+    BiquadSection makeKWeightingShelf(double sampleRate)
+    {
+        const double frequency = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double quality = 0.7071752369554196;
+
+        auto K = std::tan(pi * frequency / sampleRate);
+        auto Vh = std::pow(10.0, gainDb / 20.0);
+        auto Vb = std::pow(Vh, 0.4996667741545416);
+        auto a0 = 1.0 + K / quality + K * K;
+
+        return { (Vh + Vb * K / quality + K * K) / a0,
+                 2.0 * (K * K - Vh) / a0,
+                 (Vh - Vb * K / quality + K * K) / a0,
+                 2.0 * (K * K - 1.0) / a0,
+                 (1.0 - K / quality + K * K) / a0 };
+    }
+
+    BiquadSection makeKWeightingHighPass(double sampleRate)
+    {
+        const double frequency = 38.13547087602444;
+        const double quality = 0.5003270373238773;
+
+        auto K = std::tan(pi * frequency / sampleRate);
+        auto a0 = 1.0 + K / quality + K * K;
+
+        return { 1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / quality + K * K) / a0 };
+    }
+
+    double getMagnitudeForFrequency(const CutCoefficients& cutCoefficients, double frequency, double sampleRate)
+    {
+        auto magnitude = 1.0;
+
+        for (int i = 0; i < cutCoefficients.numSections; ++i)
+            magnitude *= getMagnitudeForFrequency(cutCoefficients.sections[(size_t) i], frequency, sampleRate);
+
+        return magnitude;
+    }
+}
+
+double getCompensationGain(const ChainCoefficients& chainCoefficients, double sampleRate, LoudnessWeighting weighting)
+{
+    auto shelf = makeKWeightingShelf(sampleRate);
+    auto highPass = makeKWeightingHighPass(sampleRate);
+
+    auto lowest = 20.0;
+    auto highest = std::min(20000.0, sampleRate * 0.49);
+
+    double inputPower = 0, outputPower = 0;
+
+    for (int i = 0; i < numFrequencies; ++i)
+    {
+        auto frequency = lowest * std::pow(highest / lowest, (i + 0.5) / numFrequencies);
+
+        auto weight = 1.0;
+
+        if (weighting == LoudnessWeighting_K)
+        {
+            weight = getMagnitudeForFrequency(shelf, frequency, sampleRate)
+                   * getMagnitudeForFrequency(highPass, frequency, sampleRate);
+            weight *= weight;
+        }
+
+        auto magnitude = 1.0;
+
+        if (chainCoefficients.lowCutActive)
+            magnitude *= getMagnitudeForFrequency(chainCoefficients.lowCut, frequency, sampleRate);
+
+        if (chainCoefficients.peakActive)
+            magnitude *= getMagnitudeForFrequency(chainCoefficients.peak, frequency, sampleRate);
+
+        if (chainCoefficients.highCutActive)
+            magnitude *= getMagnitudeForFrequency(chainCoefficients.highCut, frequency, sampleRate);
+
+        inputPower += weight;
+        outputPower += weight * magnitude * magnitude;
+    }
+
+    auto maxGain = std::pow(10.0, maxCompensationDb / 20.0);
+
+    if (outputPower <= 0)
+        return maxGain;
+
+    return std::clamp(std::sqrt(inputPower / outputPower), 1.0 / maxGain, maxGain);
+}
@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    Works out how much louder or quieter the EQ makes things straight from
+    the magnitude response of its filters, so the output can be levelled
+    without running a loudness meter on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BiquadDesign.h"
+
+// the spectrum the response is averaged over
+enum LoudnessWeighting
+{
+    // equal energy per octave
+    LoudnessWeighting_Pink,
+    // pink noise as heard through the ITU-R BS.1770 K-weighting filter
+    LoudnessWeighting_K
+};
+
+// the gain that brings the weighted loudness of the chain's output back to that of its input,
+// limited to +-maxCompensationDb. cheap enough for the message thread, but not for every sample
+double getCompensationGain(const ChainCoefficients& chainCoefficients, double sampleRate, LoudnessWeighting weighting);
+
+constexpr double maxCompensationDb = 12.0;
@@ -18,19 +18,23 @@ void ResponseCurveComponent::parameterValueChanged (int parameterIndex, float ne
 
 void ResponseCurveComponent::timerCallback()
 {
+    // we can't design any filters until the processor knows its sample rate
+    if (audioProcessor.getSampleRate() <= 0)
+        return;
+    
+    // when the governor has frozen the display the flag is left set, so the curve catches up
+    // with everything that moved as soon as it's allowed to again
+    if (audioProcessor.getQualityLevel() >= QualityLevel_FrozenDisplay)
+        return;
+    
     // check to see if parameters changed and reset it
     if (parametersChanged.compareAndSetBool(false, true))
     {
         // update the mono chain
         auto chainSettings = getChainSettings(audioProcessor.apvts);
-        auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-        updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-        
-        auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-        updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-        
-        auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-        updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+        auto chainCoefficients = makeChainCoefficients(chainSettings, audioProcessor.getSampleRate());
+        updateChain(monoChain, chainCoefficients);
+        outputGain = makeOutputGain(chainSettings, chainCoefficients, audioProcessor.getSampleRate());
         // signal a repaint
         // repaint();
     }
@@ -70,13 +74,24 @@ ResponseCurveComponent::~ResponseCurveComponent()
 NVS_EQAudioProcessorEditor::NVS_EQAudioProcessorEditor (NVS_EQAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
     responseCurveComponent(audioProcessor),
+    autoGainWeightingBox(audioProcessor.apvts.getParameter("Auto Gain Weighting")),
+    crossoverButtonAttachment(audioProcessor.apvts, "Crossover", crossoverButton),
+    autoGainButtonAttachment(audioProcessor.apvts, "Auto Gain", autoGainButton),
+    bypassButtonAttachment(audioProcessor.apvts, "Bypass", bypassButton),
+    lowCutEnabledButtonAttachment(audioProcessor.apvts, "LowCut Enabled", lowCutEnabledButton),
+    peakEnabledButtonAttachment(audioProcessor.apvts, "Peak Enabled", peakEnabledButton),
+    highCutEnabledButtonAttachment(audioProcessor.apvts, "HighCut Enabled", highCutEnabledButton),
+    governorButtonAttachment(audioProcessor.apvts, "Quality Governor", governorButton),
+    autoGainWeightingBoxAttachment(audioProcessor.apvts, "Auto Gain Weighting", autoGainWeightingBox),
     peakFreqSliderAttachment(audioProcessor.apvts, "Peak Freq", peakFreqSlider),
     peakGainSliderAttachment(audioProcessor.apvts, "Peak Gain", peakGainSlider),
     peakQualitySliderAttachment(audioProcessor.apvts, "Peak Quality", peakQualitySlider),
     lowCutFreqSliderAttachment(audioProcessor.apvts, "LowCut Freq", lowCutFreqSlider),
     highCutFreqSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider),
     lowCutSlopeSliderAttachment(audioProcessor.apvts, "LowCut Slope", lowCutSlopeSlider),
-    highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider)
+    highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider),
+    lowCutTypeSliderAttachment(audioProcessor.apvts, "LowCut Type", lowCutTypeSlider),
+    highCutTypeSliderAttachment(audioProcessor.apvts, "HighCut Type", highCutTypeSlider)
 {
     // the the vector of slider components to iterate over all GUI components in a for loop
     for (auto* comp : getComps()) {
@@ -85,14 +100,25 @@ NVS_EQAudioProcessorEditor::NVS_EQAudioProcessorEditor (NVS_EQAudioProcessor& p)
     
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (600, 400);
+    setSize (600, 430);
     repaint();
+    
+    // the level only moves every half second at the quickest, so a slow timer is plenty
+    timerCallback();
+    startTimerHz(4);
 }
 
 NVS_EQAudioProcessorEditor::~NVS_EQAudioProcessorEditor()
 {
 }
 
+void NVS_EQAudioProcessorEditor::timerCallback()
+{
+    juce::String text(getQualityLevelName(audioProcessor.getQualityLevel()));
+    text << " (" << juce::roundToInt(audioProcessor.getProcessingLoad() * 100.f) << "%)";
+    qualityLabel.setText(text, juce::dontSendNotification);
+}
+
 //==============================================================================
 void ResponseCurveComponent::paint (juce::Graphics& g)
 {
@@ -118,35 +144,17 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     
     for (int i = 0; i < w; i++)
     {
-        double mag = 1.f;
+        double mag = outputGain;
         auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-        // check to see if band is bypassed...
-        if (! monoChain.isBypassed<ChainPositions::Peak>()) {
+        // check to see if each band is switched out of the chain...
+        if (peak.isActive()) {
             mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
         }
-        if (! lowcut.isBypassed<0>()) {
-            mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        for (int section = 0; lowcut.isActive() && section < lowcut.getNumActiveSections(); ++section) {
+            mag *= lowcut.getSection(section).coefficients->getMagnitudeForFrequency(freq, sampleRate);
         }
-        if (! lowcut.isBypassed<1>()) {
-            mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! lowcut.isBypassed<2>()) {
-            mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! lowcut.isBypassed<3>()) {
-            mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! highcut.isBypassed<0>()) {
-            mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! highcut.isBypassed<1>()) {
-            mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! highcut.isBypassed<2>()) {
-            mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (! highcut.isBypassed<3>()) {
-            mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        for (int section = 0; highcut.isActive() && section < highcut.getNumActiveSections(); ++section) {
+            mag *= highcut.getSection(section).coefficients->getMagnitudeForFrequency(freq, sampleRate);
         }
         
         mags[i] = Decibels::gainToDecibels(mag);
@@ -184,6 +192,15 @@ void NVS_EQAudioProcessorEditor::resized()
     // subcomponents in your editor..
     auto bounds = getLocalBounds();
     
+    // the strip along the bottom holds the switches
+    auto buttonArea = bounds.removeFromBottom(30);
+    crossoverButton.setBounds(buttonArea.removeFromLeft(100));
+    autoGainButton.setBounds(buttonArea.removeFromLeft(100));
+    autoGainWeightingBox.setBounds(buttonArea.removeFromLeft(110).reduced(2));
+    bypassButton.setBounds(buttonArea.removeFromRight(100));
+    governorButton.setBounds(buttonArea.removeFromLeft(90));
+    qualityLabel.setBounds(buttonArea);
+    
     // remove the top third of the screen which will be used to generate the EQ graph
     auto responseArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
     responseCurveComponent.setBounds(responseArea);
@@ -194,11 +211,18 @@ void NVS_EQAudioProcessorEditor::resized()
     // what is left of bounds is now our peak area
     auto peakArea = bounds;
     
-    lowCutFreqSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight()*0.66));
-    lowCutSlopeSlider.setBounds(lowCutArea);
+    // each band gets its on/off switch along the top of its column
+    lowCutEnabledButton.setBounds(lowCutArea.removeFromTop(24));
+    peakEnabledButton.setBounds(peakArea.removeFromTop(24));
+    highCutEnabledButton.setBounds(highCutArea.removeFromTop(24));
+    
+    lowCutFreqSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight()*0.5));
+    lowCutSlopeSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight()*0.5));
+    lowCutTypeSlider.setBounds(lowCutArea);
     
-    highCutFreqSlider.setBounds(highCutArea.removeFromTop(highCutArea.getHeight()*0.66));
-    highCutSlopeSlider.setBounds(highCutArea);
+    highCutFreqSlider.setBounds(highCutArea.removeFromTop(highCutArea.getHeight()*0.5));
+    highCutSlopeSlider.setBounds(highCutArea.removeFromTop(highCutArea.getHeight()*0.5));
+    highCutTypeSlider.setBounds(highCutArea);
     
     peakFreqSlider.setBounds(peakArea.removeFromTop(peakArea.getHeight()*0.33));
     peakGainSlider.setBounds(peakArea.removeFromTop(peakArea.getHeight()*0.5));
@@ -217,6 +241,17 @@ std::vector<juce::Component*> NVS_EQAudioProcessorEditor::getComps() {
       &highCutFreqSlider,
       &lowCutSlopeSlider,
       &highCutSlopeSlider,
+      &lowCutTypeSlider,
+      &highCutTypeSlider,
+      &crossoverButton,
+      &autoGainButton,
+      &autoGainWeightingBox,
+      &bypassButton,
+      &governorButton,
+      &qualityLabel,
+      &lowCutEnabledButton,
+      &peakEnabledButton,
+      &highCutEnabledButton,
       &responseCurveComponent
     };
 }
@@ -20,6 +20,17 @@ struct CustomRotarySlider : juce::Slider
     }
 };
 
+// a combo box that lists the choices of a choice parameter. it has its items from the start,
+// so an attachment made after it can select the current choice straight away
+struct ChoiceComboBox : juce::ComboBox
+{
+    explicit ChoiceComboBox(juce::RangedAudioParameter* parameter)
+    {
+        if (auto* choiceParameter = dynamic_cast<juce::AudioParameterChoice*>(parameter))
+            addItemList(choiceParameter->choices, 1);
+    }
+};
+
 
 struct ResponseCurveComponent: juce::Component,
     juce::AudioProcessorParameter::Listener,
@@ -43,12 +54,15 @@ struct ResponseCurveComponent: juce::Component,
         juce::Atomic<bool> parametersChanged { false };
         
         MonoChain monoChain;
+        // the auto gain the processor will apply, so the curve shows what's actually heard
+        double outputGain { 1.0 };
 };
 
 //==============================================================================
 /**
 */
-class NVS_EQAudioProcessorEditor  : public juce::AudioProcessorEditor
+class NVS_EQAudioProcessorEditor  : public juce::AudioProcessorEditor,
+    private juce::Timer
 {
 public:
     NVS_EQAudioProcessorEditor (NVS_EQAudioProcessor&);
@@ -57,6 +71,9 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
+    
+    // keeps the quality readout up to date
+    void timerCallback() override;
 
     
 private:
@@ -65,14 +82,25 @@ private:
     // access the processor object that created it.
     NVS_EQAudioProcessor& audioProcessor;
     
-    CustomRotarySlider peakFreqSlider, peakGainSlider, peakQualitySlider, lowCutFreqSlider, highCutFreqSlider, lowCutSlopeSlider, highCutSlopeSlider;
+    CustomRotarySlider peakFreqSlider, peakGainSlider, peakQualitySlider, lowCutFreqSlider, highCutFreqSlider, lowCutSlopeSlider, highCutSlopeSlider, lowCutTypeSlider, highCutTypeSlider;
     
     using APVTS = juce::AudioProcessorValueTreeState;
     using Attachment = APVTS::SliderAttachment;
     
     ResponseCurveComponent responseCurveComponent;
     
-    Attachment peakFreqSliderAttachment, peakGainSliderAttachment, peakQualitySliderAttachment, lowCutFreqSliderAttachment, highCutFreqSliderAttachment, lowCutSlopeSliderAttachment, highCutSlopeSliderAttachment;
+    juce::ToggleButton crossoverButton { "Crossover" }, autoGainButton { "Auto Gain" }, bypassButton { "Bypass" };
+    juce::ToggleButton lowCutEnabledButton { "LowCut" }, peakEnabledButton { "Peak" }, highCutEnabledButton { "HighCut" };
+    ChoiceComboBox autoGainWeightingBox;
+    APVTS::ButtonAttachment crossoverButtonAttachment, autoGainButtonAttachment, bypassButtonAttachment;
+    APVTS::ButtonAttachment lowCutEnabledButtonAttachment, peakEnabledButtonAttachment, highCutEnabledButtonAttachment;
+    
+    juce::ToggleButton governorButton { "Governor" };
+    juce::Label qualityLabel;
+    APVTS::ButtonAttachment governorButtonAttachment;
+    APVTS::ComboBoxAttachment autoGainWeightingBoxAttachment;
+    
+    Attachment peakFreqSliderAttachment, peakGainSliderAttachment, peakQualitySliderAttachment, lowCutFreqSliderAttachment, highCutFreqSliderAttachment, lowCutSlopeSliderAttachment, highCutSlopeSliderAttachment, lowCutTypeSliderAttachment, highCutTypeSliderAttachment;
     
     std::vector<juce::Component*> getComps();
 
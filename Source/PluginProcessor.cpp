@@ -18,14 +18,32 @@ NVS_EQAudioProcessor::NVS_EQAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       // the band outputs only carry audio when the crossover is switched on
+                       .withOutput ("Low", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Mid", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("High", juce::AudioChannelSet::stereo(), false)
                      #endif
                        )
 #endif
 {
+    // listen to all of our parameters so that the filters get redesigned whenever one of them moves
+    for (auto* param : getParameters()) {
+        param->addListener(this);
+    }
+    
+    bypassParameter = apvts.getRawParameterValue("Bypass");
+    governorParameter = apvts.getRawParameterValue("Quality Governor");
+    
+    startTimerHz(60);
 }
 
 NVS_EQAudioProcessor::~NVS_EQAudioProcessor()
 {
+    stopTimer();
+    
+    for (auto* param : getParameters()) {
+        param->removeListener(this);
+    }
 }
 
 //==============================================================================
@@ -102,17 +120,138 @@ void NVS_EQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     // we are using two mono channels, but the processing chain is a mono processing chain
     spec.numChannels = 1;
     
-    updateFilters();
+    // the audio thread isn't running yet, so we can design and apply the filters right here
+    {
+        const juce::SpinLock::ScopedLockType lock(pendingCoefficientsLock);
+        hasPendingCoefficients = false;
+    }
+    auto chainSettings = getChainSettings(apvts);
+    chainSettings.reducedCutOrder = designedQualityLevel >= QualityLevel_ReducedOrder;
+    auto chainCoefficients = makeChainCoefficients(chainSettings, sampleRate);
+    updateFilters(chainCoefficients);
+    updateCrossovers(makeCrossoverCoefficients(chainSettings, sampleRate), chainSettings.crossoverEnabled);
+    
+    outputGain.reset(sampleRate, 0.05);
+    outputGain.setCurrentAndTargetValue(makeOutputGain(chainSettings, chainCoefficients, sampleRate));
     
     LeftChain.prepare(spec);
     RightChain.prepare(spec);
+    LeftCrossover.prepare(spec);
+    RightCrossover.prepare(spec);
+    
+    // start off wherever the bypass switch already is rather than fading in from it
+    bypassFade.prepare(sampleRate);
+    bypassFade.setTarget(bypassParameter->load() < 0.5f);
+    bypassFade.snapToTarget();
+    bypassDryBuffer.setSize(2, samplesPerBlock);
+    
+    qualityGovernor.prepare(sampleRate);
+}
+
+void NVS_EQAudioProcessor::updateFilters(const ChainCoefficients &chainCoefficients)
+{
+    updateChain(LeftChain, chainCoefficients);
+    updateChain(RightChain, chainCoefficients);
+}
+
+void NVS_EQAudioProcessor::updateCrossovers(const CrossoverCoefficients &crossoverCoefficients, bool shouldBeEnabled)
+{
+    // whatever was left in the band filters from the last time the crossover ran is stale now
+    if (shouldBeEnabled && ! crossoverEnabled)
+    {
+        LeftCrossover.reset();
+        RightCrossover.reset();
+    }
+    
+    LeftCrossover.setCoefficients(crossoverCoefficients);
+    RightCrossover.setCoefficients(crossoverCoefficients);
+    crossoverEnabled = shouldBeEnabled;
+}
+
+void NVS_EQAudioProcessor::parameterValueChanged (int parameterIndex, float newValue)
+{
+    // this can be called from the audio thread, so all we do is raise a flag for the timer
+    parametersChanged.set(true);
+}
+
+void NVS_EQAudioProcessor::timerCallback()
+{
+    auto sampleRate = getSampleRate();
+    
+    // nothing to design for until prepareToPlay has given us a sample rate
+    if (sampleRate <= 0)
+        return;
+    
+    // the governor moves on the audio thread, this is where its level takes effect
+    auto qualityLevel = qualityGovernor.getLevel();
+    
+    if (qualityLevel != designedQualityLevel)
+    {
+        // the first thing to go is how quickly the filters follow the controls
+        auto updateRate = qualityLevel >= QualityLevel_SlowUpdates ? 15 : 60;
+        
+        if (getTimerInterval() != 1000 / updateRate)
+            startTimerHz(updateRate);
+        
+        // and changing the cut order means redesigning them. the cut filters crossfade
+        // between the old and new number of sections, so this doesn't click
+        if ((qualityLevel >= QualityLevel_ReducedOrder) != (designedQualityLevel >= QualityLevel_ReducedOrder))
+            parametersChanged.set(true);
+        
+        designedQualityLevel = qualityLevel;
+    }
+    
+    // an offline render designs its filters at the start of each block, see applyFiltersForOfflineRender()
+    if (isNonRealtime())
+        return;
+    
+    if (parametersChanged.compareAndSetBool(false, true))
+    {
+        auto chainSettings = getChainSettings(apvts);
+        chainSettings.reducedCutOrder = designedQualityLevel >= QualityLevel_ReducedOrder;
+        auto chainCoefficients = makeChainCoefficients(chainSettings, sampleRate);
+        auto crossoverCoefficients = makeCrossoverCoefficients(chainSettings, sampleRate);
+        auto gain = makeOutputGain(chainSettings, chainCoefficients, sampleRate);
+        
+        const juce::SpinLock::ScopedLockType lock(pendingCoefficientsLock);
+        pendingCoefficients = chainCoefficients;
+        pendingCrossoverCoefficients = crossoverCoefficients;
+        pendingCrossoverEnabled = chainSettings.crossoverEnabled;
+        pendingOutputGain = gain;
+        hasPendingCoefficients = true;
+    }
+}
+
+void NVS_EQAudioProcessor::applyPendingCoefficients()
+{
+    // if the message thread is halfway through handing over new coefficients we just
+    // pick them up on the next block instead
+    const juce::SpinLock::ScopedTryLockType lock(pendingCoefficientsLock);
+    
+    if (lock.isLocked() && hasPendingCoefficients)
+    {
+        updateFilters(pendingCoefficients);
+        updateCrossovers(pendingCrossoverCoefficients, pendingCrossoverEnabled);
+        outputGain.setTargetValue(pendingOutputGain);
+        hasPendingCoefficients = false;
+    }
 }
 
-void NVS_EQAudioProcessor::updateFilters() {
+void NVS_EQAudioProcessor::applyFiltersForOfflineRender()
+{
+    // rendering offline runs faster than the timer, and the message thread may not run at all,
+    // so changes have to land on the block they were automated for or the render comes out
+    // different every time. allocating here is fine, nobody is waiting on this block in real time
+    if (! parametersChanged.compareAndSetBool(false, true))
+        return;
+    
+    auto sampleRate = getSampleRate();
     auto chainSettings = getChainSettings(apvts);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilter(chainSettings);
-    updateLowCutFilter(chainSettings);
+    auto chainCoefficients = makeChainCoefficients(chainSettings, sampleRate);
+    
+    updateFilters(chainCoefficients);
+    updateCrossovers(makeCrossoverCoefficients(chainSettings, sampleRate), chainSettings.crossoverEnabled);
+    outputGain.setTargetValue(makeOutputGain(chainSettings, chainCoefficients, sampleRate));
 }
 
 void NVS_EQAudioProcessor::releaseResources()
@@ -142,35 +281,26 @@ bool NVS_EQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
         return false;
    #endif
 
+    // each band output can be switched off, otherwise it has to match the main output
+    for (int bus = OutputBuses::LowBandBus; bus <= OutputBuses::HighBandBus; ++bus)
+    {
+        auto bandChannelSet = layouts.getChannelSet(false, bus);
+        
+        if (! bandChannelSet.isDisabled() && bandChannelSet != layouts.getMainOutputChannelSet())
+            return false;
+    }
+
     return true;
   #endif
 }
 #endif
 
-void NVS_EQAudioProcessor::updateLowCutFilter(const ChainSettings &chainSettings)
-{
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-    
-    auto& leftLowCut = LeftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = RightChain.get<ChainPositions::LowCut>();
-    
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-}
-
-void NVS_EQAudioProcessor::updateHighCutFilter(const ChainSettings &chainSettings)
-{
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-    
-    auto& leftHighCut = LeftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = RightChain.get<ChainPositions::HighCut>();
-
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
-}
-
 void NVS_EQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    // an offline render has no deadline to keep, and should always come out at full quality
+    qualityGovernor.setEnabled(governorParameter->load() > 0.5f && ! isNonRealtime());
+    
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -184,24 +314,164 @@ void NVS_EQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    // Update the Peak Filter - All working correctly
-    updateFilters();
+    // pick up any filters that were redesigned on the message thread since the last block
+    applyPendingCoefficients();
+    
+    if (isNonRealtime())
+        applyFiltersForOfflineRender();
+    
+    // fully bypassed there's nothing to do at all, the input is already sitting in the output
+    auto wasBypassed = bypassFade.isOff();
+    bypassFade.setTarget(bypassParameter->load() < 0.5f);
+    
+    if (bypassFade.isOff())
+    {
+        measureBlock(startTicks, buffer.getNumSamples());
+        return;
+    }
+    
+    // the filters stopped running when we were bypassed, so whatever they hold is from back then.
+    // the low sections can ring on that for seconds, so start them from silence instead
+    if (wasBypassed)
+    {
+        LeftChain.reset();
+        RightChain.reset();
+        LeftCrossover.reset();
+        RightCrossover.reset();
+    }
+    
+    auto numSamples = buffer.getNumSamples();
+    auto isBypassFading = bypassFade.isFading();
+    
+    if (isBypassFading)
+    {
+        bypassDryBuffer.copyFrom(0, 0, buffer, 0, 0, numSamples);
+        bypassDryBuffer.copyFrom(1, 0, buffer, 1, 0, numSamples);
+    }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // TODO - what does this code really do? add better notes!
     // block is initialised with our current audio buffer
     // create an audio block which can be sent to our processes
-    juce::dsp::AudioBlock<float> block(buffer);
+    if (crossoverEnabled)
+    {
+        processCrossover(LeftChain, LeftCrossover, buffer, 0);
+        processCrossover(RightChain, RightCrossover, buffer, 1);
+    }
+    else
+    {
+        juce::dsp::AudioBlock<float> block(buffer);
+        
+        auto leftBlock = block.getSingleChannelBlock(0);
+        auto rightBlock = block.getSingleChannelBlock(1);
+        
+        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        
+        // now we can pass these contexts to our mono filter chains...
+        LeftChain.process(leftContext);
+        RightChain.process(rightContext);
+    }
+    
+    applyOutputGain(buffer);
+    
+    // the main output fades against the input. the band outputs have no dry signal, so they
+    // fade to and from the silence they carry while we're bypassed
+    if (isBypassFading)
+    {
+        std::array<const float*, maxBypassFadeChannels> dry {};
+        dry[0] = bypassDryBuffer.getReadPointer(0);
+        dry[1] = bypassDryBuffer.getReadPointer(1);
+        
+        auto numChannels = juce::jmin(buffer.getNumChannels(), maxBypassFadeChannels);
+        bypassFade.process(buffer.getArrayOfWritePointers(), dry.data(), numChannels, numSamples);
+    }
+    
+    measureBlock(startTicks, numSamples);
+}
+
+void NVS_EQAudioProcessor::measureBlock(juce::int64 startTicks, int numSamples)
+{
+    auto secondsTaken = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    qualityGovernor.addMeasurement(secondsTaken, numSamples);
+}
+
+void NVS_EQAudioProcessor::applyOutputGain(juce::AudioBuffer<float> &buffer)
+{
+    auto numSamples = buffer.getNumSamples();
+    auto* left = buffer.getWritePointer(0);
+    auto* right = buffer.getWritePointer(1);
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    // only the main output gets levelled, and once the gain has settled it's a single multiply
+    if (outputGain.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto gain = outputGain.getNextValue();
+            left[i] *= gain;
+            right[i] *= gain;
+        }
+    }
+    else if (outputGain.getTargetValue() != 1.f)
+    {
+        juce::FloatVectorOperations::multiply(left, outputGain.getTargetValue(), numSamples);
+        juce::FloatVectorOperations::multiply(right, outputGain.getTargetValue(), numSamples);
+    }
+}
+
+juce::AudioProcessorParameter* NVS_EQAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter("Bypass");
+}
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+void NVS_EQAudioProcessor::processCrossover(MonoChain &chain, CrossoverChain &crossover, juce::AudioBuffer<float> &buffer, int channel)
+{
+    // the main output ends up as the low-cut -> peak -> high-cut signal exactly like it does without
+    // the crossover, which is also the mid band. the low and high bands get split off along the way,
+    // so the low-cut and high-cut filters are only ever run once
+    juce::dsp::AudioBlock<float> mainBlock = juce::dsp::AudioBlock<float>(buffer).getSingleChannelBlock((size_t) channel);
+    juce::dsp::ProcessContextReplacing<float> mainContext(mainBlock);
     
-    // now we can pass these contexts to our mono filter chains...
-    LeftChain.process(leftContext);
-    RightChain.process(rightContext);
+    // the bands are returned as buffers that point into our main buffer, nothing gets allocated here
+    auto lowBus = getBusBuffer(buffer, false, OutputBuses::LowBandBus);
+    auto midBus = getBusBuffer(buffer, false, OutputBuses::MidBandBus);
+    auto highBus = getBusBuffer(buffer, false, OutputBuses::HighBandBus);
+    
+    // the peak goes first so every band gets it. the filters are all linear so moving it in front
+    // of the low-cut doesn't change the main output
+    chain.get<ChainPositions::Peak>().process(mainContext);
+    
+    if (channel < lowBus.getNumChannels())
+    {
+        auto lowBlock = juce::dsp::AudioBlock<float>(lowBus).getSingleChannelBlock((size_t) channel);
+        juce::dsp::ProcessContextReplacing<float> lowContext(lowBlock);
+        
+        lowBlock.copyFrom(mainBlock);
+        crossover.lowBand.process(lowContext);
+        crossover.lowBandAllpass.process(lowContext);
+        
+        if (crossover.invertLowBand)
+            lowBlock.multiplyBy(-1.f);
+    }
+    
+    chain.get<ChainPositions::LowCut>().process(mainContext);
+    
+    if (channel < highBus.getNumChannels())
+    {
+        auto highBlock = juce::dsp::AudioBlock<float>(highBus).getSingleChannelBlock((size_t) channel);
+        juce::dsp::ProcessContextReplacing<float> highContext(highBlock);
+        
+        highBlock.copyFrom(mainBlock);
+        crossover.highBand.process(highContext);
+        
+        if (crossover.invertHighBand)
+            highBlock.multiplyBy(-1.f);
+    }
+    
+    chain.get<ChainPositions::HighCut>().process(mainContext);
+    
+    if (channel < midBus.getNumChannels())
+        juce::dsp::AudioBlock<float>(midBus).getSingleChannelBlock((size_t) channel).copyFrom(mainBlock);
 }
 
 //==============================================================================
@@ -243,7 +513,7 @@ void NVS_EQAudioProcessor::setStateInformation (const void* data, int sizeInByte
     if (tree.isValid()) {
         apvts.replaceState(tree);
         // make the state in the software reflect the loaded data
-        updateFilters();
+        parametersChanged.set(true);
     }
 }
 
@@ -256,29 +526,270 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
     settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
     settings.lowCutSlope = static_cast<Slope>( apvts.getRawParameterValue("LowCut Slope")->load());
     settings.highCutSlope = static_cast<Slope>( apvts.getRawParameterValue("HighCut Slope")->load());
+    settings.lowCutFamily = static_cast<CutFamily>( apvts.getRawParameterValue("LowCut Type")->load());
+    settings.highCutFamily = static_cast<CutFamily>( apvts.getRawParameterValue("HighCut Type")->load());
+    settings.crossoverEnabled = apvts.getRawParameterValue("Crossover")->load() > 0.5f;
+    settings.autoGainEnabled = apvts.getRawParameterValue("Auto Gain")->load() > 0.5f;
+    settings.autoGainWeighting = static_cast<LoudnessWeighting>( apvts.getRawParameterValue("Auto Gain Weighting")->load());
     settings.peakGain = apvts.getRawParameterValue("Peak Gain")->load();
     settings.peakQ = apvts.getRawParameterValue("Peak Quality")->load();
+    settings.lowCutEnabled = apvts.getRawParameterValue("LowCut Enabled")->load() > 0.5f;
+    settings.peakEnabled = apvts.getRawParameterValue("Peak Enabled")->load() > 0.5f;
+    settings.highCutEnabled = apvts.getRawParameterValue("HighCut Enabled")->load() > 0.5f;
     
     return settings;
 }
 
-void updateCoefficients(Coefficients &old, const Coefficients &replacement)
+void updateCoefficients(Filter& filter, const BiquadSection& section)
+{
+    if (filter.coefficients->getFilterOrder() != 2)
+        filter.coefficients = new juce::dsp::IIR::Coefficients<float>(1, 0, 0, 1, 0, 0);
+    
+    // JUCE keeps a biquad as b0, b1, b2, a1, a2 all divided through by a0, the same as our sections
+    auto* raw = filter.coefficients->getRawCoefficients();
+    raw[0] = static_cast<float>(section.b0);
+    raw[1] = static_cast<float>(section.b1);
+    raw[2] = static_cast<float>(section.b2);
+    raw[3] = static_cast<float>(section.a1);
+    raw[4] = static_cast<float>(section.a2);
+}
+
+BiquadSection makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    return designPeakSection(chainSettings.peakFreq, sampleRate, chainSettings.peakQ, juce::Decibels::decibelsToGain( chainSettings.peakGain));
+}
+
+double getSlopeAttenuationDb(Slope slope)
+{
+    return 12.0 * (slope + 1);
+}
+
+int getCutOrder(CutFamily family, Slope slope, bool reducedCutOrder)
+{
+    auto order = getMinimumCutOrder(family, getSlopeAttenuationDb(slope));
+    return reducedCutOrder ? getReducedCutOrder(order) : order;
+}
+
+CutCoefficients makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    // as crossover points the cut filters have to be Linkwitz-Riley for the bands to sum back to flat
+    auto family = chainSettings.crossoverEnabled ? CutFamily_LinkwitzRiley : chainSettings.lowCutFamily;
+    auto order = getCutOrder(family, chainSettings.lowCutSlope, chainSettings.reducedCutOrder);
+    return designCutFilter(family, true, chainSettings.lowCutFreq, sampleRate, order, getSlopeAttenuationDb(chainSettings.lowCutSlope));
+}
+
+CutCoefficients makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    auto family = chainSettings.crossoverEnabled ? CutFamily_LinkwitzRiley : chainSettings.highCutFamily;
+    auto order = getCutOrder(family, chainSettings.highCutSlope, chainSettings.reducedCutOrder);
+    return designCutFilter(family, false, chainSettings.highCutFreq, sampleRate, order, getSlopeAttenuationDb(chainSettings.highCutSlope));
+}
+
+ChainCoefficients makeChainCoefficients(const ChainSettings& chainSettings, double sampleRate)
+{
+    ChainCoefficients chainCoefficients;
+    
+    chainCoefficients.peak = makePeakFilter(chainSettings, sampleRate);
+    chainCoefficients.lowCut = makeLowCutFilter(chainSettings, sampleRate);
+    chainCoefficients.highCut = makeHighCutFilter(chainSettings, sampleRate);
+    
+    // a stage that's switched off, or sitting where it can't change anything, is left out of the chain.
+    // a low-cut at 20 Hz still rolls off a little below the audible range, but not audibly. a high-cut
+    // only counts as neutral up near Nyquist, at 88.2 or 96 kHz a 20 kHz high-cut is doing real work.
+    // as crossover points the cuts are part of the band split, so they always have to run
+    chainCoefficients.lowCutSwitchedOn = chainSettings.crossoverEnabled || chainSettings.lowCutEnabled;
+    chainCoefficients.peakSwitchedOn = chainSettings.peakEnabled;
+    chainCoefficients.highCutSwitchedOn = chainSettings.crossoverEnabled || chainSettings.highCutEnabled;
+    
+    chainCoefficients.lowCutActive = chainSettings.crossoverEnabled
+                                  || (chainSettings.lowCutEnabled && chainSettings.lowCutFreq > 20.f);
+    chainCoefficients.peakActive = chainSettings.peakEnabled && chainSettings.peakGain != 0.f;
+    chainCoefficients.highCutActive = chainSettings.crossoverEnabled
+                                   || (chainSettings.highCutEnabled && chainSettings.highCutFreq < neutralHighCutRatio * sampleRate);
+    
+    return chainCoefficients;
+}
+
+void updateChain(MonoChain& chain, const ChainCoefficients& chainCoefficients)
+{
+    chain.get<ChainPositions::LowCut>().setCoefficients(chainCoefficients.lowCut);
+    updateCoefficients(chain.get<ChainPositions::Peak>(), chainCoefficients.peak);
+    chain.get<ChainPositions::HighCut>().setCoefficients(chainCoefficients.highCut);
+    
+    chain.get<ChainPositions::LowCut>().setActive(chainCoefficients.lowCutActive, chainCoefficients.lowCutSwitchedOn);
+    chain.get<ChainPositions::Peak>().setActive(chainCoefficients.peakActive, chainCoefficients.peakSwitchedOn);
+    chain.get<ChainPositions::HighCut>().setActive(chainCoefficients.highCutActive, chainCoefficients.highCutSwitchedOn);
+}
+
+CrossoverCoefficients makeCrossoverCoefficients(const ChainSettings& chainSettings, double sampleRate)
+{
+    CrossoverCoefficients crossoverCoefficients;
+    
+    // the band filters have to match the order the cuts are actually running at
+    auto lowOrder = getCutOrder(CutFamily_LinkwitzRiley, chainSettings.lowCutSlope, chainSettings.reducedCutOrder);
+    auto highOrder = getCutOrder(CutFamily_LinkwitzRiley, chainSettings.highCutSlope, chainSettings.reducedCutOrder);
+    
+    crossoverCoefficients.lowBand = designCutFilter(CutFamily_LinkwitzRiley, false, chainSettings.lowCutFreq, sampleRate, lowOrder);
+    crossoverCoefficients.lowBandAllpass = designLinkwitzRileyAllpass(chainSettings.highCutFreq, sampleRate, highOrder);
+    crossoverCoefficients.highBand = designCutFilter(CutFamily_LinkwitzRiley, true, chainSettings.highCutFreq, sampleRate, highOrder);
+    crossoverCoefficients.invertLowBand = isLinkwitzRileyPairInverted(lowOrder);
+    crossoverCoefficients.invertHighBand = isLinkwitzRileyPairInverted(highOrder);
+    
+    return crossoverCoefficients;
+}
+
+float makeOutputGain(const ChainSettings& chainSettings, const ChainCoefficients& chainCoefficients, double sampleRate)
+{
+    // with the crossover on the main output is only the mid band, so there's nothing sensible to level it to
+    if (! chainSettings.autoGainEnabled || chainSettings.crossoverEnabled)
+        return 1.f;
+    
+    return static_cast<float>(getCompensationGain(chainCoefficients, sampleRate, chainSettings.autoGainWeighting));
+}
+
+//==============================================================================
+void CrossoverChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    lowBand.prepare(spec);
+    lowBandAllpass.prepare(spec);
+    highBand.prepare(spec);
+}
+
+void CrossoverChain::reset()
+{
+    lowBand.reset();
+    lowBandAllpass.reset();
+    highBand.reset();
+}
+
+void CrossoverChain::setCoefficients(const CrossoverCoefficients& crossoverCoefficients)
+{
+    lowBand.setCoefficients(crossoverCoefficients.lowBand);
+    lowBandAllpass.setCoefficients(crossoverCoefficients.lowBandAllpass);
+    highBand.setCoefficients(crossoverCoefficients.highBand);
+    invertLowBand = crossoverCoefficients.invertLowBand;
+    invertHighBand = crossoverCoefficients.invertHighBand;
+}
+
+//==============================================================================
+void Crossfade::prepare(double sampleRate) noexcept
+{
+    step = static_cast<float>(1.0 / (fadeSeconds * sampleRate));
+}
+
+void Crossfade::process(float* const* wet, const float* const* dry, int numChannels, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        position = position < target ? juce::jmin(target, position + step)
+                                     : juce::jmax(target, position - step);
+        
+        auto wetGain = position;
+        auto dryGain = 1.f - position;
+        
+        // sin and cos of the same angle keep the summed power constant all the way through the fade
+        if (law == FadeLaw_EqualPower)
+        {
+            auto angle = position * juce::MathConstants<float>::halfPi;
+            wetGain = std::sin(angle);
+            dryGain = std::cos(angle);
+        }
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+            wet[channel][i] = wet[channel][i] * wetGain + (dry[channel] != nullptr ? dry[channel][i] * dryGain : 0.f);
+    }
+}
+
+//==============================================================================
+CutFilterChain::CutFilterChain()
+{
+    // start every section off as a second order pass-through so updates never need to reallocate
+    for (auto& bank : banks) {
+        for (auto& section : bank) {
+            section.coefficients = new juce::dsp::IIR::Coefficients<float>(1, 0, 0, 1, 0, 0);
+        }
+    }
+}
+
+void CutFilterChain::prepare(const juce::dsp::ProcessSpec& spec)
 {
-    *old = *replacement;
+    for (auto& bank : banks) {
+        for (auto& section : bank) {
+            section.prepare(spec);
+        }
+    }
+    
+    outgoingBuffer.resize(spec.maximumBlockSize);
+    sampleRate = spec.sampleRate;
+    bankFade.prepare(spec.sampleRate);
+    isPrepared = true;
+    
+    reset();
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+void CutFilterChain::reset()
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, chainSettings.peakFreq, chainSettings.peakQ, juce::Decibels::decibelsToGain( chainSettings.peakGain));
+    for (auto& bank : banks) {
+        for (auto& section : bank) {
+            section.reset();
+        }
+    }
+    
+    // with both banks starting over from silence there's nothing left to fade between
+    bankFade.snapToTarget();
+    preRollSamples = 0;
+    
+    if (hasDeferredCoefficients)
+    {
+        hasDeferredCoefficients = false;
+        setCoefficients(deferredCoefficients);
+    }
 }
 
-void NVS_EQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+void CutFilterChain::setCoefficients(const CutCoefficients& cutCoefficients)
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    // TODO - pretty sure that this should be done within a GUI-rate function instead of audio-rate...
-    // can this be moved to paint or something instead?
-    updateCoefficients(LeftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(RightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    auto newNumSections = juce::jlimit(1, maxCutSections, cutCoefficients.numSections);
+    
+    // while the banks are changing over, a new slope waits until they're done. a new tuning
+    // of the slope we're heading to goes straight into the incoming bank
+    if (bankFade.isFading())
+    {
+        hasDeferredCoefficients = newNumSections != numSections[activeBank];
+        
+        if (hasDeferredCoefficients)
+        {
+            deferredCoefficients = cutCoefficients;
+            return;
+        }
+    }
+    
+    // a new slope gets loaded into the other bank and faded over to. before prepare there's no audio to fade
+    auto bank = activeBank;
+    
+    if (isPrepared && newNumSections != numSections[activeBank])
+    {
+        bank = 1 - activeBank;
+        
+        for (auto& section : banks[bank]) {
+            section.reset();
+        }
+    }
+    
+    for (int i = 0; i < newNumSections; ++i) {
+        updateCoefficients(banks[bank][(size_t) i], cutCoefficients.sections[(size_t) i]);
+    }
+    
+    numSections[bank] = newNumSections;
+    
+    if (bank != activeBank)
+    {
+        activeBank = bank;
+        preRollSamples = getSettlingSamples(cutCoefficients, sampleRate);
+        
+        bankFade.setTarget(false);
+        bankFade.snapToTarget();
+        bankFade.setTarget(true);
+    }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout
@@ -296,10 +807,11 @@ juce::AudioProcessorValueTreeState::ParameterLayout
         
         // gain amount for the EQ
         
-        // string array for the low and highcut EQ options
+        // string array for the low and highcut EQ options. each slope is how far down the cut is one
+        // octave past its cutoff, which the Chebyshev and elliptic designs reach with fewer sections
         
         juce::StringArray stringArray;
-        for (int i = 0; i < 4; ++i)
+        for (int i = 0; i < 8; ++i)
         {
             juce::String str;
             str << (12 + i * 12);
@@ -311,9 +823,38 @@ juce::AudioProcessorValueTreeState::ParameterLayout
 
         layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
         
+        // which filter design the low and highcut use, in the same order as CutFamily
+        juce::StringArray familyArray { "Butterworth", "Chebyshev", "Elliptic", "Linkwitz-Riley" };
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Type", "LowCut Type", familyArray, 0));
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Type", "HighCut Type", familyArray, 0));
+        
+        // turns the low and highcut into Linkwitz-Riley crossover points feeding the Low, Mid and High outputs
+        layout.add(std::make_unique<juce::AudioParameterBool>("Crossover", "Crossover", false));
+        
+        // levels the output against the response of the filters, so boosts and cuts can be compared fairly
+        layout.add(std::make_unique<juce::AudioParameterBool>("Auto Gain", "Auto Gain", false));
+        
+        // the spectrum auto gain measures loudness against, in the same order as LoudnessWeighting
+        layout.add(std::make_unique<juce::AudioParameterChoice>("Auto Gain Weighting", "Auto Gain Weighting", juce::StringArray { "Pink", "K-weighted" }, 0));
+        
         // gain amount for the EQ
         layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Gain", "Peak Gain", juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.f));
         
+        // each band can be switched out of the chain on its own, with a short crossfade so it doesn't click
+        layout.add(std::make_unique<juce::AudioParameterBool>("LowCut Enabled", "LowCut Enabled", true));
+        
+        layout.add(std::make_unique<juce::AudioParameterBool>("Peak Enabled", "Peak Enabled", true));
+        
+        layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Enabled", "HighCut Enabled", true));
+        
+        // fades the whole EQ out against its input, the host's own bypass button is tied to this too
+        layout.add(std::make_unique<juce::AudioParameterBool>("Bypass", "Bypass", false));
+        
+        // lets the EQ give up quality on its own when the session is running out of CPU
+        layout.add(std::make_unique<juce::AudioParameterBool>("Quality Governor", "Quality Governor", false));
+        
         // gain amount for the EQ
         layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Quality", "Peak Quality", juce::NormalisableRange<float>(0.1f, 10.f, 0.005f, 1.f), 0.7f));
         
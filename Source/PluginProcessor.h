@@ -9,13 +9,20 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BiquadDesign.h"
+#include "LoudnessCompensation.h"
+#include "QualityGovernor.h"
 
 enum Slope
 {
   Slope_12,
   Slope_24,
   Slope_36,
-  Slope_48
+  Slope_48,
+  Slope_60,
+  Slope_72,
+  Slope_84,
+  Slope_96
 };
 
 struct ChainSettings
@@ -25,8 +32,18 @@ struct ChainSettings
     float peakFreq{1.f};
     Slope lowCutSlope{Slope::Slope_12};
     Slope highCutSlope{Slope::Slope_12};
+    CutFamily lowCutFamily{CutFamily_Butterworth};
+    CutFamily highCutFamily{CutFamily_Butterworth};
     float peakGain{0};
     float peakQ{0};
+    bool crossoverEnabled{false};
+    bool autoGainEnabled{false};
+    LoudnessWeighting autoGainWeighting{LoudnessWeighting_Pink};
+    bool lowCutEnabled{true};
+    bool peakEnabled{true};
+    bool highCutEnabled{true};
+    // set by the quality governor rather than a parameter, when the session is short of CPU
+    bool reducedCutOrder{false};
 };
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
@@ -34,65 +51,268 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
 // create an alies for this datatype that is more human-readable
 using Filter = juce::dsp::IIR::Filter<float>;
 
-// need 4x of these filters in a processing chain for the low-pass filter, high-pass filter, and other parameters for our EQ
-using QuadFilterProcessingChain = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-
-// we need to create a chain for each channel of audio =)
-using MonoChain = juce::dsp::ProcessorChain<QuadFilterProcessingChain, Filter, QuadFilterProcessingChain>;
+// how the two sides of a Crossfade are weighted on the way through
+enum FadeLaw
+{
+    // sin and cos, for signals that have little to do with each other, like a filter and its input
+    FadeLaw_EqualPower,
+    // gains summing to 1, for two versions of nearly the same signal, which equal power would boost by 3 dB
+    FadeLaw_EqualGain
+};
 
-enum ChainPositions
+// a crossfade from a dry signal to a wet one and back, run a block at a time.
+// fully on means all wet, fully off all dry
+class Crossfade
 {
-    LowCut, Peak, HighCut
+public:
+    explicit Crossfade(FadeLaw fadeLaw = FadeLaw_EqualPower) noexcept : law(fadeLaw) {}
+    
+    void prepare(double sampleRate) noexcept;
+    
+    void setTarget(bool shouldBeOn) noexcept { target = shouldBeOn ? 1.f : 0.f; }
+    
+    // a fade that's already running carries on with the law it started with, so turning it round doesn't jump
+    void setTarget(bool shouldBeOn, FadeLaw fadeLaw) noexcept
+    {
+        if (! isFading())
+            law = fadeLaw;
+        
+        setTarget(shouldBeOn);
+    }
+    void snapToTarget() noexcept { position = target; }
+    
+    bool getTarget() const noexcept { return target > 0.f; }
+    bool isFading() const noexcept { return position != target; }
+    bool isOff() const noexcept { return position == 0.f && target == 0.f; }
+    
+    // mixes dry into wet in place, moving the fade on by numSamples. a channel whose dry
+    // pointer is null has no dry signal and just fades to and from silence
+    void process(float* const* wet, const float* const* dry, int numChannels, int numSamples) noexcept;
+    
+private:
+    // how long a fade takes to run from one end to the other
+    static constexpr double fadeSeconds = 0.01;
+    
+    FadeLaw law;
+    float position{1.f}, target{1.f};
+    float step{static_cast<float>(1.0 / (fadeSeconds * 44100.0))};
 };
 
-using Coefficients = Filter::CoefficientsPtr;
+// a cascade of up to maxCutSections biquads for the low-cut and high-cut filters.
+// how many sections run is set by the slope, and each slope gets its own loop whose
+// length is known at compile time rather than checking a bypass flag per section.
+// a change of slope loads the new cascade into a second bank of sections and crossfades
+// over to it, so nothing clicks when sections come and go. both banks put out nearly the same
+// signal in the passband, so that fade keeps the gain rather than the power constant.
+// the new bank starts from silence, and at a low cutoff it rings for far longer than the fade
+// before it settles, so it runs unheard on the live input until it has, and only then fades in
+class CutFilterChain
+{
+public:
+    CutFilterChain();
 
-void updateCoefficients(Coefficients &old, const Coefficients &replacement);
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+    // safe to call from the audio thread, nothing is allocated
+    void setCoefficients(const CutCoefficients& cutCoefficients);
 
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, sampleRate, (chainSettings.lowCutSlope + 1) * 2);
-}
+    int getNumActiveSections() const noexcept { return numSections[activeBank]; }
+    const Filter& getSection(int index) const noexcept { return banks[activeBank][(size_t) index]; }
 
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq, sampleRate, (chainSettings.highCutSlope + 1) * 2);
-}
-
-template <typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType &leftLowCut, const CoefficientType &cutCoefficients, const Slope &lowCutSlope) {
-    leftLowCut.template setBypassed<0>(true);
-    leftLowCut.template setBypassed<1>(true);
-    leftLowCut.template setBypassed<2>(true);
-    leftLowCut.template setBypassed<3>(true);
-
-    switch (lowCutSlope) {
-        case Slope_48:
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+    {
+        if (! bankFade.isFading())
         {
-            *leftLowCut.template get<3>().coefficients = *cutCoefficients[3];
-            leftLowCut.template setBypassed<3>(false);
+            processBank(activeBank, context);
+            return;
         }
-        case Slope_36:
+        
+        // run the outgoing bank on a copy of the input and fade from it to the incoming one
+        auto& block = context.getOutputBlock();
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        float* samples = block.getChannelPointer(0);
+        float* outgoing = outgoingBuffer.data();
+        
+        juce::FloatVectorOperations::copy(outgoing, samples, numSamples);
+        
+        juce::dsp::AudioBlock<float> outgoingBlock(&outgoing, (size_t) 1, static_cast<size_t>(numSamples));
+        processBank(1 - activeBank, juce::dsp::ProcessContextReplacing<float>(outgoingBlock));
+        processBank(activeBank, context);
+        
+        // while the incoming bank settles only the outgoing one is heard
+        auto numPreRolled = juce::jmin(numSamples, preRollSamples);
+        juce::FloatVectorOperations::copy(samples, outgoing, numPreRolled);
+        preRollSamples -= numPreRolled;
+        
+        float* wet = samples + numPreRolled;
+        const float* dry = outgoing + numPreRolled;
+        bankFade.process(&wet, &dry, 1, numSamples - numPreRolled);
+        
+        if (! bankFade.isFading() && hasDeferredCoefficients)
         {
-            *leftLowCut.template get<2>().coefficients = *cutCoefficients[2];
-            leftLowCut.template setBypassed<2>(false);
+            hasDeferredCoefficients = false;
+            setCoefficients(deferredCoefficients);
         }
-        case Slope_24:
+    }
+
+private:
+    using Bank = std::array<Filter, maxCutSections>;
+    
+    void processBank(size_t bank, const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+    {
+        switch (numSections[bank])
         {
-            *leftLowCut.template get<1>().coefficients = *cutCoefficients[1];
-            leftLowCut.template setBypassed<1>(false);
-            break;
+            case 1: processSections<1>(banks[bank], context); break;
+            case 2: processSections<2>(banks[bank], context); break;
+            case 3: processSections<3>(banks[bank], context); break;
+            case 4: processSections<4>(banks[bank], context); break;
+            case 5: processSections<5>(banks[bank], context); break;
+            case 6: processSections<6>(banks[bank], context); break;
+            case 7: processSections<7>(banks[bank], context); break;
+            case 8: processSections<8>(banks[bank], context); break;
+            default: break;
         }
-        case Slope_12:
+    }
+
+    template <size_t NumSections>
+    static void processSections(Bank& bank, const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+    {
+        processSectionSequence(bank, context, std::make_index_sequence<NumSections>());
+    }
+
+    template <size_t... Indices>
+    static void processSectionSequence(Bank& bank, const juce::dsp::ProcessContextReplacing<float>& context, std::index_sequence<Indices...>) noexcept
+    {
+        (bank[Indices].process(context), ...);
+    }
+
+    std::array<Bank, 2> banks;
+    std::array<int, 2> numSections{1, 1};
+    size_t activeBank{0};
+    
+    bool isPrepared{false};
+    double sampleRate{44100};
+    Crossfade bankFade { FadeLaw_EqualGain };
+    int preRollSamples{0};
+    std::vector<float> outgoingBuffer;
+    
+    // a change of slope that arrived while the banks were still changing over
+    CutCoefficients deferredCoefficients;
+    bool hasDeferredCoefficients{false};
+};
+
+// wraps a stage of the chain so it can be switched in and out with a short crossfade against its
+// own input. once it has faded out it drops out of the processing loop completely
+template <typename ProcessorType>
+class FadingStage : public ProcessorType
+{
+public:
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        ProcessorType::prepare(spec);
+        fade.prepare(spec.sampleRate);
+        fade.snapToTarget();
+        dryBuffer.resize(spec.maximumBlockSize);
+    }
+    
+    // isSwitchedOn is whether the stage is switched in at all. switching it in or out gets an
+    // equal-power fade, but a stage that stays switched in only comes and goes as it moves to
+    // or from where it's neutral. its output is then its input, and equal power would bump the
+    // level 3 dB halfway through, so those fades keep the gain constant instead
+    void setActive(bool shouldBeActive, bool isSwitchedOn) noexcept
+    {
+        // a stage coming back in still holds whatever it was doing when it went out
+        if (shouldBeActive && fade.isOff())
+            ProcessorType::reset();
+        
+        fade.setTarget(shouldBeActive, isSwitchedOn && wasSwitchedOn ? FadeLaw_EqualGain : FadeLaw_EqualPower);
+        wasSwitchedOn = isSwitchedOn;
+    }
+    
+    bool isActive() const noexcept { return fade.getTarget(); }
+    
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+    {
+        if (fade.isOff())
+            return;
+        
+        if (! fade.isFading())
         {
-            *leftLowCut.template get<0>().coefficients = *cutCoefficients[0];
-            leftLowCut.template setBypassed<0>(false);
-            break;
+            ProcessorType::process(context);
+            return;
         }
+        
+        auto& block = context.getOutputBlock();
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        float* samples = block.getChannelPointer(0);
+        const float* dry = dryBuffer.data();
+        
+        juce::FloatVectorOperations::copy(dryBuffer.data(), samples, numSamples);
+        ProcessorType::process(context);
+        fade.process(&samples, &dry, 1, numSamples);
     }
-}
+    
+private:
+    Crossfade fade;
+    bool wasSwitchedOn{true};
+    std::vector<float> dryBuffer;
+};
+
+// we need to create a chain for each channel of audio =)
+using MonoChain = juce::dsp::ProcessorChain<FadingStage<CutFilterChain>, FadingStage<Filter>, FadingStage<CutFilterChain>>;
+
+enum ChainPositions
+{
+    LowCut, Peak, HighCut
+};
+
+// the extra filters each channel needs when the low-cut and high-cut double as a three band
+// crossover. the main chain's cut filters already do half of the work, so only the low band
+// lowpass, its phase matching allpass and the high band high pass live in here
+struct CrossoverChain
+{
+    CutFilterChain lowBand, lowBandAllpass, highBand;
+    bool invertLowBand{false}, invertHighBand{false};
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+    void setCoefficients(const CrossoverCoefficients& crossoverCoefficients);
+};
+
+enum OutputBuses
+{
+    MainBus, LowBandBus, MidBandBus, HighBandBus
+};
+
+// writes a designed section into the filter's coefficients in place. only the first update of a
+// filter that isn't second order yet allocates, so do that before the audio thread gets to it
+void updateCoefficients(Filter& filter, const BiquadSection& section);
+
+BiquadSection makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+
+// how far down a cut with this slope is one octave past its cutoff
+double getSlopeAttenuationDb(Slope slope);
+
+// the lowest order at which a cut of this family reaches its slope, halved (but at least 2)
+// when the governor asks for it
+int getCutOrder(CutFamily family, Slope slope, bool reducedCutOrder);
+
+CutCoefficients makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate);
+CutCoefficients makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate);
+
+// a high-cut at or above this fraction of the sample rate is too close to Nyquist to change anything audible
+constexpr double neutralHighCutRatio = 0.45;
+
+// designs every filter in the chain, this allocates so keep it off the audio thread
+ChainCoefficients makeChainCoefficients(const ChainSettings& chainSettings, double sampleRate);
+
+void updateChain(MonoChain& chain, const ChainCoefficients& chainCoefficients);
+
+CrossoverCoefficients makeCrossoverCoefficients(const ChainSettings& chainSettings, double sampleRate);
+
+// the gain applied after the chain, which is 1 unless auto gain is levelling it out
+float makeOutputGain(const ChainSettings& chainSettings, const ChainCoefficients& chainCoefficients, double sampleRate);
 
 //==============================================================================
 /**
@@ -101,6 +321,8 @@ class NVS_EQAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                            , private juce::AudioProcessorParameter::Listener
+                            , private juce::Timer
 {
 public:
     //==============================================================================
@@ -151,14 +373,60 @@ public:
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters",
         createParameterLayout()};
     
+    // hosts that know about it will use our soft bypass instead of cutting us out abruptly
+    juce::AudioProcessorParameter* getBypassParameter() const override;
+    
+    // what the quality governor is currently doing, for the editor to show
+    QualityLevel getQualityLevel() const noexcept { return qualityGovernor.getLevel(); }
+    float getProcessingLoad() const noexcept { return qualityGovernor.getLoad(); }
+    
 private:
     // create two instances of MonoChain
     MonoChain LeftChain, RightChain;
+    CrossoverChain LeftCrossover, RightCrossover;
+    bool crossoverEnabled { false };
+    
+    // smoothed so that a redesign of the filters never steps the output level
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> outputGain { 1.f };
+    
+    // fades the whole EQ against its input. read straight from the parameter every block
+    // rather than waiting on the timer, so bypassing responds as soon as it's asked to
+    std::atomic<float>* bypassParameter { nullptr };
+    Crossfade bypassFade;
+    juce::AudioBuffer<float> bypassDryBuffer;
+    // the main output and the three band outputs, all stereo
+    static constexpr int maxBypassFadeChannels = 8;
+    
+    // times every block and gives up quality when the host is running out of CPU
+    std::atomic<float>* governorParameter { nullptr };
+    QualityGovernor qualityGovernor;
+    // the level the filters were last designed for, only touched on the message thread
+    QualityLevel designedQualityLevel { QualityLevel_Full };
+    
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override { }
+
+    // the filters are designed here on the message thread and handed over to the audio thread
+    void timerCallback() override;
+    
+    void updateFilters(const ChainCoefficients &chainCoefficients);
+    void updateCrossovers(const CrossoverCoefficients &crossoverCoefficients, bool shouldBeEnabled);
+    void applyPendingCoefficients();
+    void applyFiltersForOfflineRender();
+    
+    void processCrossover(MonoChain &chain, CrossoverChain &crossover, juce::AudioBuffer<float> &buffer, int channel);
+    void applyOutputGain(juce::AudioBuffer<float> &buffer);
+    void measureBlock(juce::int64 startTicks, int numSamples);
+    
+    juce::Atomic<bool> parametersChanged { false };
     
-    void updatePeakFilter(const ChainSettings &chainSettings);
-    void updateLowCutFilter(const ChainSettings &chainSettings);
-    void updateHighCutFilter(const ChainSettings &chainSettings);
-    void updateFilters();
+    // the audio thread only ever tries to take this lock, so it never waits on the message thread
+    juce::SpinLock pendingCoefficientsLock;
+    ChainCoefficients pendingCoefficients;
+    CrossoverCoefficients pendingCrossoverCoefficients;
+    bool pendingCrossoverEnabled { false };
+    float pendingOutputGain { 1.f };
+    bool hasPendingCoefficients { false };
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NVS_EQAudioProcessor)
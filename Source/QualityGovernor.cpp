@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    The CPU load governor for the EQ.
+
+  ==============================================================================
+*/
+
+#include "QualityGovernor.h"
+
+#include <cmath>
+
+const char* getQualityLevelName(QualityLevel level)
+{
+    switch (level)
+    {
+        case QualityLevel_SlowUpdates:      return "Slow updates";
+        case QualityLevel_FrozenDisplay:    return "Frozen display";
+        case QualityLevel_ReducedOrder:     return "Reduced order";
+        case QualityLevel_Full:
+        default:                            return "Full";
+    }
+}
+
+void QualityGovernor::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    smoothedLoad = 0;
+    secondsAboveStepDown = 0;
+    secondsBelowStepUp = 0;
+    load = 0.f;
+}
+
+void QualityGovernor::setEnabled(bool shouldBeEnabled) noexcept
+{
+    if (! shouldBeEnabled)
+    {
+        level = QualityLevel_Full;
+        secondsAboveStepDown = 0;
+        secondsBelowStepUp = 0;
+    }
+
+    enabled = shouldBeEnabled;
+}
+
+void QualityGovernor::addMeasurement(double secondsTaken, int numSamples) noexcept
+{
+    if (numSamples <= 0 || sampleRate <= 0)
+        return;
+
+    auto blockSeconds = numSamples / sampleRate;
+    auto blockLoad = secondsTaken / blockSeconds;
+
+    // a one pole smoother, scaled so the time constant doesn't depend on the block size
+    smoothedLoad += (blockLoad - smoothedLoad) * (1.0 - std::exp(-blockSeconds / smoothingSeconds));
+    load = static_cast<float>(smoothedLoad);
+
+    if (! enabled)
+        return;
+
+    auto currentLevel = level.load();
+
+    // whichever threshold the load isn't past starts its wait over
+    secondsAboveStepDown = smoothedLoad > stepDownLoad ? secondsAboveStepDown + blockSeconds : 0;
+    secondsBelowStepUp = smoothedLoad < stepUpLoad ? secondsBelowStepUp + blockSeconds : 0;
+
+    if (secondsAboveStepDown >= stepDownSeconds && currentLevel < QualityLevel_ReducedOrder)
+    {
+        level = currentLevel + 1;
+        secondsAboveStepDown = 0;
+    }
+    else if (secondsBelowStepUp >= stepUpSeconds && currentLevel > QualityLevel_Full)
+    {
+        level = currentLevel - 1;
+        secondsBelowStepUp = 0;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    Watches how long each processBlock takes against the time the host gives
+    it, and steps the EQ's quality down when a session is running out of CPU.
+    Nothing in here depends on JUCE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+// the order quality is given up in, each level keeping everything the ones before it dropped.
+// there's no analyzer in the EQ yet, so pausing one isn't a step of its own
+enum QualityLevel
+{
+    // everything as designed
+    QualityLevel_Full,
+    // the filters get redesigned a quarter as often while a control is moving
+    QualityLevel_SlowUpdates,
+    // the response curve in the editor stops following the controls
+    QualityLevel_FrozenDisplay,
+    // the low-cut and high-cut run at half their order
+    QualityLevel_ReducedOrder
+};
+
+const char* getQualityLevelName(QualityLevel level);
+
+// measurements come in from the audio thread, the level and load can be read from anywhere
+class QualityGovernor
+{
+public:
+    void prepare(double sampleRate) noexcept;
+
+    // when switched off the governor goes straight back to full quality
+    void setEnabled(bool shouldBeEnabled) noexcept;
+
+    // call at the end of every block with how long it took. the time is wall clock time, so when
+    // the machine is overloaded and the audio thread gets pre-empted that shows up here as well
+    void addMeasurement(double secondsTaken, int numSamples) noexcept;
+
+    QualityLevel getLevel() const noexcept { return static_cast<QualityLevel>(level.load()); }
+
+    // the smoothed fraction of each block's deadline spent processing it
+    float getLoad() const noexcept { return load.load(); }
+
+private:
+    // an EQ on its own should only ever use a sliver of the deadline, so a tenth of it
+    // already means the host is struggling
+    static constexpr double stepDownLoad = 0.1;
+    static constexpr double stepUpLoad = 0.04;
+
+    // load has to stay past a threshold this long before the level moves. coming back up
+    // waits much longer, so a level isn't restored just to be dropped again
+    static constexpr double stepDownSeconds = 0.5;
+    static constexpr double stepUpSeconds = 3.0;
+
+    // time constant of the load smoothing, long enough to ride over a single slow block
+    static constexpr double smoothingSeconds = 0.2;
+
+    double sampleRate{44100};
+    double smoothedLoad{0};
+    double secondsAboveStepDown{0}, secondsBelowStepUp{0};
+
+    std::atomic<bool> enabled{false};
+    std::atomic<int> level{QualityLevel_Full};
+    std::atomic<float> load{0};
+};
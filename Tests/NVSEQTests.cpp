@@ -0,0 +1,404 @@
+/*
+  ==============================================================================
+
+    Checks on the parts of the EQ that don't depend on JUCE: the filter
+    designs meet their specs, the Linkwitz-Riley bands sum back to flat, the
+    fixed-point chain keeps its SNR and produces the same bits it always has,
+    the quality governor steps the way it's documented to, and the cut filters
+    change order without a transient.
+
+    Returns non-zero if anything fails, so ctest can run it.
+
+  ==============================================================================
+*/
+
+#include "FixedPointChain.h"
+#include "FixedPointScenarios.h"
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    using Complex = std::complex<double>;
+
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double sampleRate = 48000.0;
+
+    int numFailures = 0;
+
+    void expect(bool condition, const char* what, double value = 0)
+    {
+        if (! condition)
+        {
+            std::printf("FAILED: %s (%g)\n", what, value);
+            ++numFailures;
+        }
+    }
+
+    Complex getResponse(const BiquadSection& section, double frequency)
+    {
+        auto z = std::polar(1.0, -2.0 * pi * frequency / sampleRate);   // z^-1
+        return (section.b0 + z * (section.b1 + z * section.b2)) / (1.0 + z * (section.a1 + z * section.a2));
+    }
+
+    Complex getResponse(const CutCoefficients& coefficients, double frequency)
+    {
+        Complex response = 1.0;
+
+        for (int i = 0; i < coefficients.numSections; ++i)
+            response *= getResponse(coefficients.sections[(size_t) i], frequency);
+
+        return response;
+    }
+
+    double getGainDb(const CutCoefficients& coefficients, double frequency)
+    {
+        return 20.0 * std::log10(std::abs(getResponse(coefficients, frequency)));
+    }
+
+    //==============================================================================
+    // the same split the plugin makes in processCrossover, with the peak left out
+    void testCrossoverSumsFlat()
+    {
+        const double lowFrequency = 200, highFrequency = 3000;
+
+        for (int order = 2; order <= maxCutOrder; order += 2)
+        {
+            auto lowCut = designCutFilter(CutFamily_LinkwitzRiley, true, lowFrequency, sampleRate, order);
+            auto highCut = designCutFilter(CutFamily_LinkwitzRiley, false, highFrequency, sampleRate, order);
+            auto lowBand = designCutFilter(CutFamily_LinkwitzRiley, false, lowFrequency, sampleRate, order);
+            auto lowBandAllpass = designLinkwitzRileyAllpass(highFrequency, sampleRate, order);
+            auto highBand = designCutFilter(CutFamily_LinkwitzRiley, true, highFrequency, sampleRate, order);
+            auto sign = isLinkwitzRileyPairInverted(order) ? -1.0 : 1.0;
+
+            double worstDb = 0;
+
+            for (int i = 0; i <= 200; ++i)
+            {
+                auto frequency = 20.0 * std::pow(1000.0, i / 200.0);
+
+                auto low = sign * getResponse(lowBand, frequency) * getResponse(lowBandAllpass, frequency);
+                auto mid = getResponse(lowCut, frequency) * getResponse(highCut, frequency);
+                auto high = sign * getResponse(lowCut, frequency) * getResponse(highBand, frequency);
+
+                worstDb = std::max(worstDb, std::abs(20.0 * std::log10(std::abs(low + mid + high))));
+            }
+
+            expect(worstDb < 1e-6, "Linkwitz-Riley bands sum flat", worstDb);
+        }
+    }
+
+    //==============================================================================
+    // a sweep of cutoffs, including high-cuts far enough up that their octave would be past Nyquist
+    const double cutoffs[] = { 30, 100, 1000, 5000, 10000, 13000, 16000, 20000 };
+
+    void testCutDesigns()
+    {
+        for (auto cutoff : cutoffs)
+        {
+            for (int isHighPass = 0; isHighPass <= 1; ++isHighPass)
+            {
+                // one octave into the stopband (or as close to Nyquist as we can get), the far end of
+                // the stopband, and how far from the cutoff to check the passband
+                auto octave = isHighPass ? cutoff / 2 : std::min(cutoff * 2, sampleRate * 0.499);
+                auto stopbandEnd = isHighPass ? 1.0 : sampleRate * 0.499;
+                auto passbandEnd = isHighPass ? std::min(cutoff * 20, sampleRate * 0.499) : cutoff / 50;
+
+                for (int order = 2; order <= maxCutOrder; order += 2)
+                {
+                    auto butterworth = designCutFilter(CutFamily_Butterworth, isHighPass, cutoff, sampleRate, order);
+                    expect(std::abs(getGainDb(butterworth, cutoff) + 3.0103) < 0.01, "Butterworth is -3 dB at the cutoff", getGainDb(butterworth, cutoff));
+
+                    auto linkwitzRiley = designCutFilter(CutFamily_LinkwitzRiley, isHighPass, cutoff, sampleRate, order);
+                    expect(std::abs(getGainDb(linkwitzRiley, cutoff) + 6.0206) < 0.01, "Linkwitz-Riley is -6 dB at the cutoff", getGainDb(linkwitzRiley, cutoff));
+
+                    for (auto family : { CutFamily_Chebyshev, CutFamily_Elliptic })
+                    {
+                        auto ripple = designCutFilter(family, isHighPass, cutoff, sampleRate, order);
+                        expect(std::abs(getGainDb(ripple, cutoff) + 0.5) < 0.01, "ripple designs are at the 0.5 dB ripple edge at the cutoff", getGainDb(ripple, cutoff));
+
+                        // the whole passband stays inside the ripple
+                        for (int i = 0; i <= 100; ++i)
+                        {
+                            auto frequency = cutoff * std::pow(passbandEnd / cutoff, i / 100.0);
+                            auto gainDb = getGainDb(ripple, frequency);
+                            expect(gainDb < 0.01 && gainDb > -0.51, "ripple designs stay within 0.5 dB in the passband", gainDb);
+                        }
+                    }
+
+                    // from eighth order on the elliptic stopband starts within an octave, and never comes back above -80 dB
+                    if (order >= 8)
+                    {
+                        auto elliptic = designCutFilter(CutFamily_Elliptic, isHighPass, cutoff, sampleRate, order);
+
+                        for (int i = 0; i <= 200; ++i)
+                        {
+                            auto frequency = octave * std::pow(stopbandEnd / octave, i / 200.0);
+                            expect(getGainDb(elliptic, frequency) < -minimumStopbandAttenuationDb + 0.01, "elliptic stopband is at least 80 dB down", getGainDb(elliptic, frequency));
+                        }
+                    }
+                }
+
+                // every family reaches each slope's attenuation one octave out, at every cutoff. past the
+                // gentlest slope the ripple designs never need more sections for it than Butterworth does.
+                // at 12 dB they do, their cutoff is the 0.5 dB ripple edge rather than the -3 dB point
+                for (auto family : { CutFamily_Butterworth, CutFamily_Chebyshev, CutFamily_Elliptic, CutFamily_LinkwitzRiley })
+                {
+                    auto previousOrder = 0;
+
+                    for (int slope = 1; slope <= 8; ++slope)
+                    {
+                        auto attenuationDb = 12.0 * slope;
+                        auto butterworthOrder = getMinimumCutOrder(CutFamily_Butterworth, attenuationDb);
+                        auto order = getMinimumCutOrder(family, attenuationDb);
+                        auto design = designCutFilter(family, isHighPass, cutoff, sampleRate, order, attenuationDb);
+
+                        // Butterworth's 6 dB/Oct per order only holds asymptotically, so it gets a little slack
+                        expect(getGainDb(design, octave) < -attenuationDb + 0.5, "cut reaches its slope one octave out", getGainDb(design, octave));
+                        expect(slope == 1 || order <= butterworthOrder, "ripple designs need no more order than Butterworth", order);
+
+                        // the order doesn't depend on the cutoff at all, so all that's left to go wrong is a
+                        // steeper slope asking for fewer sections
+                        expect(order >= previousOrder, "cut order never drops as the slope gets steeper", order);
+                        previousOrder = order;
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    // double precision reference, sections in design order
+    std::vector<double> makeReference(const std::vector<float>& input, const ChainCoefficients& coefficients)
+    {
+        std::vector<BiquadSection> sections(coefficients.lowCut.sections.begin(), coefficients.lowCut.sections.begin() + coefficients.lowCut.numSections);
+        sections.push_back(coefficients.peak);
+        sections.insert(sections.end(), coefficients.highCut.sections.begin(), coefficients.highCut.sections.begin() + coefficients.highCut.numSections);
+
+        std::vector<double> output(input.begin(), input.end());
+
+        for (auto& section : sections)
+        {
+            double state1 = 0, state2 = 0;
+
+            for (auto& sample : output)
+            {
+                auto in = sample;
+                sample = section.b0 * in + state1;
+                state1 = section.b1 * in - section.a1 * sample + state2;
+                state2 = section.b2 * in - section.a2 * sample;
+            }
+        }
+
+        return output;
+    }
+
+    template <typename Format>
+    void checkFixedPoint(const ChainCoefficients& coefficients, const std::vector<float>& input, const std::vector<double>& reference,
+                         double minimumSnrDb, uint64_t expectedChecksum)
+    {
+        using Chain = FixedPointMonoChain<Format>;
+        using Sample = typename Format::Sample;
+
+        Chain chain;
+        chain.setCoefficients(coefficients);
+
+        std::vector<Sample> samples(input.size());
+
+        for (size_t i = 0; i < input.size(); ++i)
+            samples[i] = Chain::fromFloat(input[i]);
+
+        for (int start = 0; start < FixedPointScenarios::numSamples; start += FixedPointScenarios::blockSize)
+            chain.process(samples.data() + start, std::min(FixedPointScenarios::blockSize, FixedPointScenarios::numSamples - start));
+
+        double signal = 0, noise = 0;
+
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            auto error = reference[i] - Chain::toFloat(samples[i]);
+            signal += reference[i] * reference[i];
+            noise += error * error;
+        }
+
+        auto snrDb = 10.0 * std::log10(signal / noise);
+        expect(snrDb > minimumSnrDb, "fixed-point SNR", snrDb);
+
+        auto checksum = FixedPointScenarios::getChecksum(samples);
+        expect(checksum == expectedChecksum, "fixed-point output matches its stored checksum", (double) checksum);
+    }
+
+    void testFixedPointChain()
+    {
+        // the same scenarios, signal and checksums as Benchmarks/FixedPointBenchmark.cpp
+        auto input = FixedPointScenarios::makeTestSignal();
+
+        for (auto& scenario : FixedPointScenarios::scenarios)
+        {
+            auto coefficients = FixedPointScenarios::makeCoefficients(scenario);
+            auto reference = makeReference(input, coefficients);
+
+            checkFixedPoint<Q31>(coefficients, input, reference, 95.0, scenario.q31Checksum);
+            checkFixedPoint<Q15>(coefficients, input, reference, 60.0, scenario.q15Checksum);
+        }
+    }
+
+    //==============================================================================
+    // a cascade of sections run one sample at a time, in double so that only the transition shows up
+    struct Cascade
+    {
+        CutCoefficients coefficients;
+        double state1[maxCutSections] {}, state2[maxCutSections] {};
+
+        double process(double sample)
+        {
+            for (int i = 0; i < coefficients.numSections; ++i)
+            {
+                auto& section = coefficients.sections[(size_t) i];
+                auto in = sample;
+                sample = section.b0 * in + state1[i];
+                state1[i] = section.b1 * in - section.a1 * sample + state2[i];
+                state2[i] = section.b2 * in - section.a2 * sample;
+            }
+
+            return sample;
+        }
+    };
+
+    // the governor's reduced order step swaps a cut for one of half the order the way CutFilterChain
+    // does: the new cascade starts from silence, runs unheard for its settling time, and then gets a
+    // 10 ms equal-gain fade. all the way through, the output should stay between what the two cuts put
+    // out when settled, apart from what's left of the new one's start-up transient
+    void testReducedOrderTransition()
+    {
+        const double fadeSamples = 0.01 * sampleRate;
+
+        for (auto family : { CutFamily_Butterworth, CutFamily_Chebyshev, CutFamily_Elliptic, CutFamily_LinkwitzRiley })
+        {
+            for (int isHighPass = 0; isHighPass <= 1; ++isHighPass)
+            {
+                for (auto cutoff : { 20.5, 30.0, 1000.0, 16000.0 })
+                {
+                    for (auto attenuationDb : { 48.0, 96.0 })
+                    {
+                        auto order = getMinimumCutOrder(family, attenuationDb);
+                        auto full = designCutFilter(family, isHighPass, cutoff, sampleRate, order, attenuationDb);
+                        auto reduced = designCutFilter(family, isHighPass, cutoff, sampleRate, getReducedCutOrder(order), attenuationDb);
+
+                        // stepping down and coming back up again
+                        for (auto step : { std::make_pair(full, reduced), std::make_pair(reduced, full) })
+                        {
+                            Cascade outgoing { step.first }, incoming { step.second }, settled { step.second };
+                            auto preRollSamples = getSettlingSamples(step.second, sampleRate);
+                            auto worstDb = -200.0;
+                            uint32_t seed = 0x1234567u;
+
+                            // a second to get the outgoing cut going, then the whole transition
+                            auto start = static_cast<int>(sampleRate);
+                            auto end = start + preRollSamples + static_cast<int>(fadeSamples);
+
+                            for (int i = 0; i < end; ++i)
+                            {
+                                // a low sine and a mid sine over some noise, peaking at 0 dBFS
+                                seed = seed * 1664525u + 1013904223u;
+                                auto noise = (double) seed / 4294967296.0 * 2.0 - 1.0;
+                                auto input = 0.5 * std::sin(2.0 * pi * 40.0 * i / sampleRate)
+                                           + 0.3 * std::sin(2.0 * pi * 1000.0 * i / sampleRate) + 0.2 * noise;
+
+                                auto before = outgoing.process(input);
+                                auto after = settled.process(input);
+
+                                if (i < start)
+                                    continue;
+
+                                auto position = std::clamp((i - start - preRollSamples + 1) / fadeSamples, 0.0, 1.0);
+                                auto output = before + position * (incoming.process(input) - before);
+                                auto outside = std::max({ 0.0, output - std::max(before, after), std::min(before, after) - output });
+                                worstDb = std::max(worstDb, 20.0 * std::log10(outside + 1e-12));
+                            }
+
+                            expect(worstDb < -60.0, "reduced order transition stays between the settled cuts", worstDb);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    void testQualityGovernor()
+    {
+        constexpr int blockSize = 512;
+
+        QualityGovernor governor;
+        governor.prepare(sampleRate);
+        governor.setEnabled(true);
+
+        // feeds blocks that each take load times their own length
+        auto run = [&governor] (double load, double seconds)
+        {
+            for (double elapsed = 0; elapsed < seconds; elapsed += blockSize / sampleRate)
+                governor.addMeasurement(load * blockSize / sampleRate, blockSize);
+        };
+
+        run(0.01, 1.0);
+        expect(governor.getLevel() == QualityLevel_Full, "light load stays at full quality", governor.getLevel());
+
+        // past the step down threshold, but not yet for long enough once the smoothing has caught up
+        run(0.3, 0.4);
+        expect(governor.getLevel() == QualityLevel_Full, "a short burst of load doesn't step down", governor.getLevel());
+
+        run(0.3, 0.4);
+        expect(governor.getLevel() == QualityLevel_SlowUpdates, "sustained load steps down one level", governor.getLevel());
+
+        run(0.3, 1.1);
+        expect(governor.getLevel() == QualityLevel_ReducedOrder, "each further half second steps down another level", governor.getLevel());
+
+        run(0.3, 2.0);
+        expect(governor.getLevel() == QualityLevel_ReducedOrder, "reduced order is as low as it goes", governor.getLevel());
+
+        // between the thresholds nothing moves
+        run(0.07, 5.0);
+        expect(governor.getLevel() == QualityLevel_ReducedOrder, "load between the thresholds holds the level", governor.getLevel());
+
+        // coming back up takes three seconds a level
+        run(0.01, 2.5);
+        expect(governor.getLevel() == QualityLevel_ReducedOrder, "quality isn't restored straight away", governor.getLevel());
+
+        run(0.01, 1.0);
+        expect(governor.getLevel() == QualityLevel_FrozenDisplay, "quality is restored one level at a time", governor.getLevel());
+
+        run(0.01, 6.5);
+        expect(governor.getLevel() == QualityLevel_Full, "light load restores full quality", governor.getLevel());
+
+        run(0.3, 0.8);
+        governor.setEnabled(false);
+        expect(governor.getLevel() == QualityLevel_Full, "switching the governor off restores full quality", governor.getLevel());
+
+        run(0.5, 2.0);
+        expect(governor.getLevel() == QualityLevel_Full, "a switched off governor never steps down", governor.getLevel());
+    }
+}
+
+int main()
+{
+    testCrossoverSumsFlat();
+    testCutDesigns();
+    testFixedPointChain();
+    testReducedOrderTransition();
+    testQualityGovernor();
+
+    if (numFailures > 0)
+    {
+        std::printf("%d checks failed\n", numFailures);
+        return 1;
+    }
+
+    std::printf("all checks passed\n");
+    return 0;
+}